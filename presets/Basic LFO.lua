@@ -0,0 +1,3 @@
+-- @tags: lfo, basic
+-- 0.5 Hz sine, t is the time in seconds since playback started
+return math.sin(t * 2 * math.pi * 0.5)
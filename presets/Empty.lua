@@ -0,0 +1,2 @@
+-- @tags: empty
+return 0
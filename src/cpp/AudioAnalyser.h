@@ -0,0 +1,65 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cmath>
+
+#include "AudioFeatures.h"
+
+class AudioAnalyser {
+public:
+    void prepare(double newSampleRate) {
+        sampleRate = newSampleRate;
+        lowPassCoefficient = 1.0f - static_cast<float>(std::exp(-2.0 * juce::MathConstants<double>::pi * 200.0 / sampleRate));
+        envelope = 0.0f;
+        lowPassState = 0.0f;
+        lastSample = 0.0f;
+    }
+
+    void process(const float* data, int numSamples, AudioFeatures& features) {
+        if (numSamples <= 0)
+            return;
+
+        // Independent accumulators keep these loops vectorisable
+        float sumSquares[4] = {};
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            for (int k = 0; k < 4; k++)
+                sumSquares[k] += data[i + k] * data[i + k];
+        for (; i < numSamples; i++)
+            sumSquares[0] += data[i] * data[i];
+
+        int crossings = (lastSample < 0.0f) != (data[0] < 0.0f);
+        for (i = 1; i < numSamples; i++)
+            crossings += (data[i - 1] < 0.0f) != (data[i] < 0.0f);
+
+        const auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+        const float peak = juce::jmax(-range.getStart(), range.getEnd());
+
+        // One-pole low pass is recursive, so it stays a scalar loop
+        float lowSumSquares = 0.0f;
+        for (i = 0; i < numSamples; i++) {
+            lowPassState += lowPassCoefficient * (data[i] - lowPassState);
+            lowSumSquares += lowPassState * lowPassState;
+        }
+
+        // Envelope runs at block rate, coefficients scaled by block duration
+        const double blockSeconds = numSamples / sampleRate;
+        const float coefficient = static_cast<float>(std::exp(-blockSeconds / (peak > envelope ? 0.010 : 0.150)));
+        envelope = peak + coefficient * (envelope - peak);
+
+        features.rms = std::sqrt((sumSquares[0] + sumSquares[1] + sumSquares[2] + sumSquares[3]) / numSamples);
+        features.peak = peak;
+        features.envelope = envelope;
+        features.zeroCrossingRate = static_cast<float>(crossings / blockSeconds);
+        features.lowBand = std::sqrt(lowSumSquares / numSamples);
+
+        lastSample = data[numSamples - 1];
+    }
+
+private:
+    double sampleRate = 44100.0;
+    float lowPassCoefficient = 0.0f;
+    float lowPassState = 0.0f;
+    float envelope = 0.0f;
+    float lastSample = 0.0f;
+};
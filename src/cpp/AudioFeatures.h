@@ -0,0 +1,14 @@
+#pragma once
+
+/// Per-channel features of the audio input, readable by scripts through the LuaJIT FFI.
+/// Layout must match AUDIO_FEATURES_CDEF.
+struct AudioFeatures {
+    float rms;
+    float peak;
+    float envelope;         // peak follower, 10 ms attack / 150 ms release
+    float zeroCrossingRate; // crossings per second
+    float lowBand;          // RMS of the signal below ~200 Hz
+};
+
+static constexpr const char* AUDIO_FEATURES_CDEF =
+    "typedef struct { float rms, peak, envelope, zeroCrossingRate, lowBand; } AudioFeatures;";
@@ -0,0 +1,133 @@
+#include "LuaBytecodeCache.h"
+
+#include <fstream>
+#include <sstream>
+
+LuaBytecodeCache& LuaBytecodeCache::getInstance() {
+    static LuaBytecodeCache instance;
+    return instance;
+}
+
+int LuaBytecodeCache::loadString(lua_State* L, const char* source, size_t length) {
+    const uint64_t key = hash(source, length);
+
+    Bytecode cached;
+    {
+        std::scoped_lock lock(mutex);
+        auto* entry = sources.find(key);
+        if (entry && entry->source.compare(0, std::string::npos, source, length) == 0)
+            cached = entry->bytecode;
+    }
+
+    if (cached)
+        return loadBytecode(L, cached);
+
+    // Parse outside of the lock, other instances may be compiling at the same time
+    int status = luaL_loadbuffer(L, source, length, source);
+    if (status != LUA_OK)
+        return status;
+
+    if (auto bytecode = dump(L)) {
+        std::scoped_lock lock(mutex);
+        sources.insert(key, { std::string(source, length), bytecode });
+    }
+
+    return LUA_OK;
+}
+
+int LuaBytecodeCache::loadFile(lua_State* L, const char* path) {
+    std::error_code ec;
+    auto modificationTime = std::filesystem::last_write_time(path, ec);
+
+    Bytecode cached;
+    if (!ec) {
+        std::scoped_lock lock(mutex);
+        auto* entry = files.find(path);
+        if (entry && entry->modificationTime == modificationTime)
+            cached = entry->bytecode;
+    }
+
+    if (cached)
+        return loadBytecode(L, cached);
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        lua_pushfstring(L, "cannot open %s", path);
+        return LUA_ERRFILE;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string source = contents.str();
+
+    const std::string chunkName = std::string("@") + path;
+    int status = luaL_loadbuffer(L, source.data(), source.size(), chunkName.c_str());
+    if (status != LUA_OK)
+        return status;
+
+    if (auto bytecode = dump(L); bytecode && !ec) {
+        std::scoped_lock lock(mutex);
+        files.insert(path, { modificationTime, bytecode });
+    }
+
+    return LUA_OK;
+}
+
+bool LuaBytecodeCache::precompile(const std::string& source) {
+    lua_State* L = luaL_newstate(); // parsing needs no libraries
+    const bool ok = loadString(L, source.c_str(), source.size()) == LUA_OK;
+    lua_close(L);
+    return ok;
+}
+
+bool LuaBytecodeCache::precompileFile(const std::string& path) {
+    lua_State* L = luaL_newstate();
+    const bool ok = loadFile(L, path.c_str()) == LUA_OK;
+    lua_close(L);
+    return ok;
+}
+
+bool LuaBytecodeCache::contains(const std::string& source) const {
+    std::scoped_lock lock(mutex);
+    const auto* entry = sources.peek(hash(source.data(), source.size()));
+    return entry && entry->source == source;
+}
+
+size_t LuaBytecodeCache::size() const {
+    std::scoped_lock lock(mutex);
+    return sources.size() + files.size();
+}
+
+void LuaBytecodeCache::clear() {
+    std::scoped_lock lock(mutex);
+    sources.clear();
+    files.clear();
+}
+
+uint64_t LuaBytecodeCache::hash(const char* data, size_t length) {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < length; i++) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+LuaBytecodeCache::Bytecode LuaBytecodeCache::dump(lua_State* L) {
+    auto bytecode = std::make_shared<std::string>();
+
+    auto writer = [](lua_State*, const void* p, size_t sz, void* ud) -> int {
+        static_cast<std::string*>(ud)->append(static_cast<const char*>(p), sz);
+        return 0;
+    };
+
+    if (lua_dump(L, writer, bytecode.get()) != 0)
+        return nullptr;
+
+    return bytecode;
+}
+
+int LuaBytecodeCache::loadBytecode(lua_State* L, const Bytecode& bytecode) {
+    // The chunk name stored in the bytecode is used, so error messages are unchanged
+    return luaL_loadbuffer(L, bytecode->data(), bytecode->size(), "=bytecode");
+}
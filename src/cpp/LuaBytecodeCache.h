@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <lua.hpp>
+
+/// Process-wide cache of compiled bytecode, shared by every LuaEnv so that scripts and
+/// `require`d modules used by many plugin instances are only parsed once per process.
+/// Module files are revalidated by modification time on every load.
+class LuaBytecodeCache {
+public:
+    static LuaBytecodeCache& getInstance();
+
+    /// Same as luaL_loadbuffer with the source as chunk name, using cached bytecode if available
+    int loadString(lua_State* L, const char* source, size_t length);
+
+    /// Same as luaL_loadfile, using cached bytecode if the file has not changed since
+    int loadFile(lua_State* L, const char* path);
+
+    /// Parses `source` into the cache ahead of time on the calling thread, so that a later
+    /// loadString() of the same source does not have to parse it. Returns false on syntax errors.
+    bool precompile(const std::string& source);
+
+    /// Same as precompile(), for a module file later loaded with loadFile()
+    bool precompileFile(const std::string& path);
+
+    /// True if bytecode for `source` is cached
+    bool contains(const std::string& source) const;
+
+    size_t size() const;
+
+    void clear();
+
+    /// Per kind of entry, the least recently used sources and files are evicted beyond it
+    static constexpr size_t MAX_ENTRIES = 256;
+
+private:
+    LuaBytecodeCache() = default;
+
+    typedef std::shared_ptr<const std::string> Bytecode;
+
+    /// Map keeping at most MAX_ENTRIES values, a lookup marks the entry as most recently used
+    template <typename Key, typename Value>
+    class LruMap {
+    public:
+        Value* find(const Key& key) {
+            auto it = index.find(key);
+            if (it == index.end())
+                return nullptr;
+            entries.splice(entries.begin(), entries, it->second);
+            return &it->second->second;
+        }
+
+        const Value* peek(const Key& key) const {
+            auto it = index.find(key);
+            return it != index.end() ? &it->second->second : nullptr;
+        }
+
+        void insert(const Key& key, Value value) {
+            if (auto* existing = find(key)) {
+                *existing = std::move(value);
+                return;
+            }
+            if (entries.size() >= MAX_ENTRIES) {
+                index.erase(entries.back().first);
+                entries.pop_back();
+            }
+            entries.emplace_front(key, std::move(value));
+            index[key] = entries.begin();
+        }
+
+        size_t size() const { return entries.size(); }
+
+        void clear() {
+            index.clear();
+            entries.clear();
+        }
+
+    private:
+        std::list<std::pair<Key, Value>> entries; // most recently used first
+        std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator> index;
+    };
+
+    struct SourceEntry {
+        std::string source;
+        Bytecode bytecode;
+    };
+
+    struct FileEntry {
+        std::filesystem::file_time_type modificationTime;
+        Bytecode bytecode;
+    };
+
+    mutable std::mutex mutex;
+    LruMap<uint64_t, SourceEntry> sources;
+    LruMap<std::string, FileEntry> files;
+
+    static uint64_t hash(const char* data, size_t length);
+    static Bytecode dump(lua_State* L);
+    static int loadBytecode(lua_State* L, const Bytecode& bytecode);
+};
@@ -1,23 +1,79 @@
 #include "LuaEnv.h"
+#include "LuaBytecodeCache.h"
 
 #include <filesystem>
 #include <algorithm>
+#include <chrono>
 #include <sstream>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+LuaEnv::LuaEnv(unsigned libs)
+    : libraries(libs | LuaEnvLibraries::Required)
+{
+    const auto startTime = std::chrono::steady_clock::now();
 
-LuaEnv::LuaEnv() {
     L = luaL_newstate();
-    luaL_openlibs(L);
+
+    // Same as luaL_openlibs, but only the requested libraries
+    static const struct {
+        unsigned flag;
+        const char* name;
+        lua_CFunction open;
+    } libraryList[] = {
+        { LuaEnvLibraries::Base, "", luaopen_base },
+        { LuaEnvLibraries::Package, LUA_LOADLIBNAME, luaopen_package },
+        { LuaEnvLibraries::Table, LUA_TABLIBNAME, luaopen_table },
+        { LuaEnvLibraries::Io, LUA_IOLIBNAME, luaopen_io },
+        { LuaEnvLibraries::Os, LUA_OSLIBNAME, luaopen_os },
+        { LuaEnvLibraries::String, LUA_STRLIBNAME, luaopen_string },
+        { LuaEnvLibraries::Math, LUA_MATHLIBNAME, luaopen_math },
+        { LuaEnvLibraries::Debug, LUA_DBLIBNAME, luaopen_debug },
+        { LuaEnvLibraries::Bit, LUA_BITLIBNAME, luaopen_bit },
+        { LuaEnvLibraries::Jit, LUA_JITLIBNAME, luaopen_jit },
+    };
+    for (const auto& library : libraryList) {
+        if (!(libraries & library.flag))
+            continue;
+        lua_pushcfunction(L, library.open);
+        lua_pushstring(L, library.name);
+        lua_call(L, 1, 0);
+    }
+
+    // ffi is loaded on demand by require("ffi"), as luaL_openlibs does it
+    if (libraries & LuaEnvLibraries::Ffi) {
+        lua_getfield(L, LUA_REGISTRYINDEX, "_PRELOAD");
+        lua_pushcfunction(L, luaopen_ffi);
+        lua_setfield(L, -2, LUA_FFILIBNAME);
+        lua_pop(L, 1);
+    }
 
     /// TODO: Setup Lua env
     lua_getglobal(L, "package");
     lua_getfield(L, -1, "path");
     originalPackagePath = lua_tostring(L, -1);
-    lua_pop(L, 1);
+    lua_pop(L, 2); // pop path and package
 
     // hook print() value
     lua_pushlightuserdata(L, this);
     lua_pushcclosure(L, print_hook, 1);
     lua_setglobal(L, "print");
+
+    // require() looks in the process-wide bytecode cache before the default file searcher
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "loaders");
+    for (int i = static_cast<int>(lua_objlen(L, -1)); i >= 2; i--) {
+        lua_rawgeti(L, -1, i);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_pushlightuserdata(L, this);
+    lua_pushcclosure(L, module_searcher, 1);
+    lua_rawseti(L, -2, 2);
+    lua_pop(L, 2); // pop loaders and package
+
+    creationMemoryUsage = getMemoryUsage();
+    creationTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
 }
 
 LuaEnv::~LuaEnv() {
@@ -30,7 +86,7 @@ LuaEnvError LuaEnv::setPackagePath(const std::string& dir) {
         return std::make_optional("Path not valid: " + dir);
 
     lua_getglobal(L, "package");
-    lua_pushstring(L, (originalPackagePath + dir + "?.lua").c_str());
+    lua_pushstring(L, (originalPackagePath + ";" + (p / "?.lua").string()).c_str());
     lua_setfield(L, -2, "path");
     lua_pop(L, 1);
     return std::nullopt;
@@ -41,23 +97,80 @@ LuaEnvError LuaEnv::compile(const char* str) {
     if (compiledInstanceReference != LUA_NOREF)
         luaL_unref(L, LUA_REGISTRYINDEX, compiledInstanceReference);
 
-    if (luaL_loadstring(L, str) != LUA_OK) {
+    // Modules are required again, so changes to them are picked up
+    unloadModules();
+
+    if (LuaBytecodeCache::getInstance().loadString(L, str, std::strlen(str)) != LUA_OK) {
         // Failed
         auto ret = std::make_optional(lua_tostring(L, -1));
         lua_pop(L, 1); // pop err msg
         compiledInstanceReference = LUA_NOREF;
+        nativeExpression = std::nullopt;
         return ret;
     }
 
     compiledInstanceReference = luaL_ref(L, LUA_REGISTRYINDEX);
-    
+
+    // Scripts that are a single arithmetic expression skip the Lua VM when running
+    nativeExpression = NativeExpression::parse(str, variableNames);
+
     return std::nullopt;
 }
 
+LuaEnvError LuaEnv::preloadModules(const char* str) {
+    LuaEnvError firstError;
+
+    for (const auto& name : findRequires(str)) {
+        lua_getglobal(L, "require");
+        lua_pushstring(L, name.c_str());
+        if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
+            if (!firstError)
+                firstError = lua_tostring(L, -1);
+            lua_pop(L, 1);
+        }
+    }
+
+    return firstError;
+}
+
+std::vector<std::string> LuaEnv::findRequires(const std::string& source) {
+    std::vector<std::string> names;
+    const auto isSpace = [&source](size_t i) { return i < source.size() && std::isspace(static_cast<unsigned char>(source[i])); };
+    size_t index = 0;
+
+    while ((index = source.find("require", index)) != std::string::npos) {
+        index += 7;
+        while (isSpace(index))
+            index++;
+        if (index < source.size() && source[index] == '(')
+            index++;
+        while (isSpace(index))
+            index++;
+
+        if (index >= source.size() || (source[index] != '"' && source[index] != '\''))
+            continue;
+
+        const size_t end = source.find(source[index], index + 1);
+        if (end == std::string::npos)
+            break;
+
+        auto name = source.substr(index + 1, end - index - 1);
+        if (!name.empty() && name.find('\n') == std::string::npos
+            && std::find(names.begin(), names.end(), name) == names.end())
+            names.push_back(std::move(name));
+        index = end + 1;
+    }
+
+    return names;
+}
+
 LuaEnvResult LuaEnv::runInstance() {
     if (!hasInstance())
         return { std::make_optional("No compiled instance to run"), 0.0 };
 
+    if (nativeExpression)
+        return { std::nullopt, nativeExpression->evaluate(variables.data()) };
+
     lua_rawgeti(L, LUA_REGISTRYINDEX, compiledInstanceReference);
 
     LuaEnvResult result;
@@ -74,8 +187,169 @@ LuaEnvResult LuaEnv::runInstance() {
     return result;
 }
 
-inline bool LuaEnv::hasInstance() const {
-    return compiledInstanceReference != LUA_NOREF;
+LuaEnvError LuaEnv::runBlock(double* results, int numSamples) {
+    if (!hasInstance()) {
+        std::fill(results, results + numSamples, 0.0);
+        return std::make_optional("No compiled instance to run");
+    }
+
+    LuaEnvError firstError;
+
+    if (nativeExpression) {
+        nativeExpression->evaluateBlock(variables.data(), results, numSamples);
+    }
+    else {
+        for (int i = 0; i < numSamples; i++) {
+            for (size_t v = 0; v < variables.size(); v++)
+                if (std::abs(variables[v].increment) > 0.0)
+                    pushVariable(v, variables[v].value + variables[v].increment * i);
+
+            auto result = runInstance();
+            if (result.error && !firstError)
+                firstError = result.error;
+            results[i] = result.error ? 0.0 : result.result;
+        }
+    }
+
+    // Advance variables to the start of the next block
+    for (size_t v = 0; v < variables.size(); v++)
+        if (std::abs(variables[v].increment) > 0.0)
+            setVariable(static_cast<int>(v), variables[v].value + variables[v].increment * numSamples, variables[v].increment);
+
+    return firstError;
+}
+
+size_t LuaEnv::getMemoryUsage() const {
+    return static_cast<size_t>(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + static_cast<size_t>(lua_gc(L, LUA_GCCOUNTB, 0));
+}
+
+int LuaEnv::registerVariable(const std::string& name) {
+    auto it = std::find(variableNames.begin(), variableNames.end(), name);
+    if (it != variableNames.end())
+        return static_cast<int>(it - variableNames.begin());
+
+    variableNames.push_back(name);
+    variables.push_back({});
+    pushVariable(variables.size() - 1, 0.0);
+    return static_cast<int>(variables.size() - 1);
+}
+
+void LuaEnv::setVariable(int index, double value, double increment) {
+    variables[index] = { value, increment };
+    pushVariable(static_cast<size_t>(index), value);
+}
+
+LuaEnvError LuaEnv::bindStruct(const std::string& name, const std::string& cdef, const std::string& typeName,
+                               const void* data, size_t count) {
+    static const char* bindScript = R"(
+        local name, cdef, typeName, data, count = ...
+        local ffi = require("ffi")
+        -- Declare the type once per state, any error in the declaration itself is reported
+        if not pcall(ffi.typeof, typeName) then
+            ffi.cdef(cdef)
+        end
+        -- FFI pointers are not bounds-checked, scripts only get the pointer through this proxy
+        local elements = ffi.cast("const " .. typeName .. "*", data)
+        _G[name] = setmetatable({}, {
+            __index = function(_, i)
+                if type(i) ~= "number" or i < 0 or i >= count or i % 1 ~= 0 then
+                    error(name .. "[" .. tostring(i) .. "] is out of range 0 to " .. (count - 1), 2)
+                end
+                return elements[i]
+            end,
+            __newindex = function()
+                error(name .. " is read-only", 2)
+            end,
+            __metatable = false
+        })
+    )";
+
+    if (luaL_loadstring(L, bindScript) != LUA_OK) {
+        auto ret = std::make_optional(lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return ret;
+    }
+
+    lua_pushstring(L, name.c_str());
+    lua_pushstring(L, cdef.c_str());
+    lua_pushstring(L, typeName.c_str());
+    lua_pushlightuserdata(L, const_cast<void*>(data));
+    lua_pushnumber(L, static_cast<lua_Number>(count));
+
+    if (lua_pcall(L, 5, 0, 0) != LUA_OK) {
+        auto ret = std::make_optional(lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return ret;
+    }
+
+    return std::nullopt;
+}
+
+LuaEnvError LuaEnv::sandbox() {
+    static const char* sandboxScript = R"(
+        local ffiLoaded, ffi = pcall(require, "ffi")
+        if ffiLoaded then
+            ffi.C = nil
+            ffi.load = nil
+        end
+        package.preload.ffi = nil -- a second require would return a full ffi again
+        package.loadlib = nil
+        package.cpath = ""
+        -- preload, bytecode cache and Lua file searchers stay, the C searchers go
+        for i = #package.loaders, 4, -1 do
+            package.loaders[i] = nil
+        end
+        dofile = nil
+        loadfile = nil
+
+        -- Binary chunks start with ESC, compared without the string library
+        local function isBinary(chunk)
+            return type(chunk) == "string" and chunk >= "\27" and chunk < "\28"
+        end
+        local rawLoad, rawLoadstring = load, loadstring
+        load = function(chunk, ...)
+            if type(chunk) == "function" then
+                local source = ""
+                for piece in chunk do
+                    if piece == "" then break end
+                    source = source .. piece
+                end
+                chunk = source
+                if isBinary(chunk) then return nil, "binary chunks are not allowed" end
+                return rawLoadstring(chunk, ...)
+            end
+            if isBinary(chunk) then return nil, "binary chunks are not allowed" end
+            return rawLoad(chunk, ...)
+        end
+        loadstring = function(chunk, ...)
+            if isBinary(chunk) then return nil, "binary chunks are not allowed" end
+            return rawLoadstring(chunk, ...)
+        end
+    )";
+
+    if (luaL_loadstring(L, sandboxScript) != LUA_OK || lua_pcall(L, 0, 0, 0) != LUA_OK) {
+        auto ret = std::make_optional(lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return ret;
+    }
+
+    return std::nullopt;
+}
+
+void LuaEnv::unloadModules() {
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "loaded");
+    for (const auto& name : scriptModules) {
+        lua_pushnil(L);
+        lua_setfield(L, -2, name.c_str());
+    }
+    lua_pop(L, 2); // pop loaded and package
+    scriptModules.clear();
+}
+
+void LuaEnv::pushVariable(size_t index, double value) {
+    lua_pushnumber(L, value);
+    lua_setglobal(L, variableNames[index].c_str());
 }
 
 int LuaEnv::print_hook(lua_State* L) {
@@ -105,4 +379,25 @@ int LuaEnv::print_hook(lua_State* L) {
     }
     (*env->print_callback)(out_stream.str());
     return 0;
-}
\ No newline at end of file
+}
+
+int LuaEnv::module_searcher(lua_State* L) {
+    const char* name = luaL_checkstring(L, 1);
+
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "searchpath");
+    lua_pushstring(L, name);
+    lua_getfield(L, -3, "path");
+    lua_call(L, 2, 2);
+    if (lua_isnil(L, -2))
+        return 1; // searchpath error message lists the tried paths
+
+    const char* path = lua_tostring(L, -2);
+    if (LuaBytecodeCache::getInstance().loadFile(L, path) != LUA_OK)
+        return luaL_error(L, "error loading module " LUA_QS " from file " LUA_QS ":\n\t%s",
+                          name, path, lua_tostring(L, -1));
+
+    LuaEnv* env = static_cast<LuaEnv*>(lua_touserdata(L, lua_upvalueindex(1)));
+    env->scriptModules.push_back(name);
+    return 1;
+}
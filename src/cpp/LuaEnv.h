@@ -4,18 +4,44 @@
 #include <functional>
 #include <string>
 #include <deque>
+#include <vector>
 
 #include <lua.hpp>
 
+#include "NativeExpression.h"
+
 typedef std::optional<std::string> LuaEnvError;
 struct LuaEnvResult {
     LuaEnvError error;
     double result;
 };
 
+/// Standard libraries opened by a LuaEnv, as a bit set.
+/// base, package and jit are always opened: print and require() need them and LuaJIT only
+/// enables the JIT compiler when the jit library is opened. bindStruct() needs ffi.
+struct LuaEnvLibraries {
+    static constexpr unsigned Base = 1 << 0;
+    static constexpr unsigned Package = 1 << 1;
+    static constexpr unsigned Table = 1 << 2;
+    static constexpr unsigned String = 1 << 3;
+    static constexpr unsigned Math = 1 << 4;
+    static constexpr unsigned Bit = 1 << 5;
+    static constexpr unsigned Jit = 1 << 6;
+    static constexpr unsigned Ffi = 1 << 7;
+    static constexpr unsigned Io = 1 << 8;
+    static constexpr unsigned Os = 1 << 9;
+    static constexpr unsigned Debug = 1 << 10;
+
+    static constexpr unsigned Required = Base | Package | Jit;
+    static constexpr unsigned All = (1 << 11) - 1;
+    /// Everything a script computing values needs, without io, os and debug.
+    /// The other ways to files, processes and native code are removed by LuaEnv::sandbox().
+    static constexpr unsigned Sandboxed = All & ~(Io | Os | Debug);
+};
+
 class LuaEnv {
 public:
-    LuaEnv();
+    explicit LuaEnv(unsigned libraries = LuaEnvLibraries::All);
     ~LuaEnv();
 
     LuaEnv(const LuaEnv&) = delete;
@@ -25,18 +51,71 @@ public:
 
     LuaEnvError compile(const char* str);
 
+    /// Loads the modules `str` requires by name, see findRequires(), so the first run of the
+    /// compiled script does not read them from disk. Returns the first error.
+    LuaEnvError preloadModules(const char* str);
+
+    /// Modules loaded with a literal name, e.g. require("name") or require 'name'
+    static std::vector<std::string> findRequires(const std::string& source);
+
     LuaEnvResult runInstance();
 
-    inline bool hasInstance() const;
+    /// Evaluates the compiled instance once per sample, advancing variables by their increment.
+    /// Samples that fail are set to 0.0 and the first error of the block is returned.
+    LuaEnvError runBlock(double* results, int numSamples);
+
+    /// Registers a numeric global visible to scripts, returns its index.
+    /// Must be called before compile() for native expressions to use it.
+    int registerVariable(const std::string& name);
+
+    void setVariable(int index, double value, double increment = 0.0);
+
+    /// Exposes `count` elements of native memory to scripts as the global `name`, read-only and
+    /// indexed from 0 like a LuaJIT FFI array; other indices raise an error.
+    /// `cdef` declares `typeName`; `data` must outlive the LuaEnv.
+    LuaEnvError bindStruct(const std::string& name, const std::string& cdef, const std::string& typeName,
+                           const void* data, size_t count);
+
+    /// Removes what scripts could still use to reach files, processes or native libraries:
+    /// ffi.C, ffi.load, package.loadlib, dofile, loadfile, the C module searchers and binary
+    /// chunks in load() and loadstring(). Call it after bindStruct(), which needs the full ffi.
+    LuaEnvError sandbox();
+
+    bool hasInstance() const { return compiledInstanceReference != LUA_NOREF; }
+
+    /// True if the compiled script is a simple expression evaluated natively instead of by LuaJIT
+    bool hasNativeInstance() const { return nativeExpression.has_value(); }
+
+    /// Bytes allocated by the Lua state
+    size_t getMemoryUsage() const;
+
+    /// Measured in the constructor, after the libraries were opened
+    size_t getCreationMemoryUsage() const { return creationMemoryUsage; }
+    double getCreationTime() const { return creationTime; } // seconds
+
+    unsigned getLibraries() const { return libraries; }
 
     std::optional<std::function<void(std::string)>> print_callback;
 
 private:
+    const unsigned libraries;
+    size_t creationMemoryUsage = 0;
+    double creationTime = 0.0;
+
     int compiledInstanceReference = LUA_NOREF;
     std::string originalPackagePath;
+    std::vector<std::string> scriptModules; // modules loaded from files by require()
     lua_State* L;
 
+    std::vector<std::string> variableNames;
+    std::vector<ExpressionVariable> variables;
+    std::optional<NativeExpression> nativeExpression;
+
+    void pushVariable(size_t index, double value);
+    void unloadModules();
+
     static int print_hook(lua_State* L);
+    static int module_searcher(lua_State* L);
 };
 
 static constexpr size_t LUAENV_OUTPUTLOG_MAX_MESSAGES = 20;
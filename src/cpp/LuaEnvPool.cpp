@@ -0,0 +1,90 @@
+#include "LuaEnvPool.h"
+
+#include <algorithm>
+#include <optional>
+
+LuaEnvPool::LuaEnvPool()
+    : juce::Thread("Lua State Pool")
+{
+}
+
+LuaEnvPool::~LuaEnvPool() {
+    stopThread(STOP_TIMEOUT_MS);
+}
+
+std::unique_ptr<LuaEnv> LuaEnvPool::acquire(unsigned libraries) {
+    libraries |= LuaEnvLibraries::Required;
+    {
+        std::scoped_lock lock(mutex);
+        auto& envs = ready[libraries];
+        if (!envs.empty()) {
+            auto env = std::move(envs.back());
+            envs.pop_back();
+            notify(); // refill
+            return env;
+        }
+    }
+
+    return std::make_unique<LuaEnv>(libraries);
+}
+
+void LuaEnvPool::reserve(unsigned libraries, size_t count) {
+    libraries |= LuaEnvLibraries::Required;
+    {
+        std::scoped_lock lock(mutex);
+        auto& target = reserved[libraries];
+        target = std::min(target + count, MAX_RESERVED);
+
+        if (!isThreadRunning())
+            startThread(juce::Thread::Priority::background);
+    }
+    notify();
+}
+
+void LuaEnvPool::release(unsigned libraries, size_t count) {
+    libraries |= LuaEnvLibraries::Required;
+    std::vector<std::unique_ptr<LuaEnv>> unused;
+    {
+        std::scoped_lock lock(mutex);
+        auto& target = reserved[libraries];
+        target -= std::min(target, count);
+
+        // States beyond the reserve are closed outside of the lock
+        auto& envs = ready[libraries];
+        while (envs.size() > target) {
+            unused.push_back(std::move(envs.back()));
+            envs.pop_back();
+        }
+    }
+}
+
+size_t LuaEnvPool::available(unsigned libraries) const {
+    std::scoped_lock lock(mutex);
+    auto it = ready.find(libraries | LuaEnvLibraries::Required);
+    return it != ready.end() ? it->second.size() : 0;
+}
+
+void LuaEnvPool::run() {
+    while (!threadShouldExit()) {
+        // Find a library set that is below its reserve
+        std::optional<unsigned> missing;
+        {
+            std::scoped_lock lock(mutex);
+            auto it = std::find_if(reserved.begin(), reserved.end(), [this](const auto& entry) {
+                return ready[entry.first].size() < entry.second;
+            });
+            if (it != reserved.end())
+                missing = it->first;
+        }
+
+        if (!missing) {
+            wait(-1);
+            continue;
+        }
+
+        auto env = std::make_unique<LuaEnv>(*missing);
+
+        std::scoped_lock lock(mutex);
+        ready[*missing].push_back(std::move(env));
+    }
+}
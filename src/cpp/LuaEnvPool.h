@@ -0,0 +1,45 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "LuaEnv.h"
+
+/// Pool of ready-to-use LuaEnvs. A background thread keeps the reserved number of states per
+/// library set constructed, so plugin instances created in bulk take a prepared state instead
+/// of building one on their own thread.
+/// The plugin shares one pool per process through juce::SharedResourcePointer, so the thread
+/// is stopped when the last instance is deleted rather than during static destruction.
+class LuaEnvPool : private juce::Thread {
+public:
+    LuaEnvPool();
+    ~LuaEnvPool() override;
+
+    LuaEnvPool(const LuaEnvPool&) = delete;
+    LuaEnvPool& operator=(const LuaEnvPool&) = delete;
+
+    /// Takes a prepared LuaEnv, or constructs one on the calling thread if none is ready
+    std::unique_ptr<LuaEnv> acquire(unsigned libraries);
+
+    /// Keeps `count` more LuaEnvs with `libraries` prepared, reservations of all callers add up
+    void reserve(unsigned libraries, size_t count);
+
+    /// Gives back a reservation made with reserve()
+    void release(unsigned libraries, size_t count);
+
+    size_t available(unsigned libraries) const;
+
+    static constexpr size_t MAX_RESERVED = 64;
+    static constexpr int STOP_TIMEOUT_MS = 2000;
+
+private:
+    void run() override;
+
+    mutable std::mutex mutex;
+    std::map<unsigned, std::vector<std::unique_ptr<LuaEnv>>> ready;
+    std::map<unsigned, size_t> reserved;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+
+/// Converts a block of script outputs in [-1, 1] into MIDI messages at their exact sample
+/// offsets. Values are quantised to the resolution of the message type and a message is
+/// only added when the quantised value moved by at least `threshold` steps and at least
+/// `minInterval` samples passed since the previous one. A value held back by the interval is
+/// sent once it has passed, so the final value of a movement always arrives.
+/// Messages are passed as raw bytes to `addMessage(const uint8_t* bytes, int size, int sampleOffset)`,
+/// e.g. juce::MidiBuffer::addEvent, so the encoder itself does not depend on JUCE.
+class MidiOutputEncoder {
+public:
+    enum class Mode {
+        ControlChange = 0,  // 7-bit CC
+        ControlChange14Bit, // MSB on `controller`, LSB on `controller + 32`
+        PitchBend
+    };
+
+    struct Destination {
+        int channel; // 1 to 16
+        int controller;
+    };
+
+    /// Destination of output `outputChannel` of `slot`. Slots get consecutive controllers and
+    /// output channels consecutive MIDI channels; pitch bend has no controller, so every output
+    /// of every slot gets its own MIDI channel. Returns nothing unless all `numSlots` slots times
+    /// `numOutputChannels` outputs fit from `baseChannel` and `baseController` on, so outputs
+    /// never share a controller or channel.
+    static std::optional<Destination> getDestination(Mode mode, int baseChannel, int baseController,
+                                                     int slot, int numSlots, int outputChannel, int numOutputChannels) {
+        if (slot < 0 || slot >= numSlots || outputChannel < 0 || outputChannel >= numOutputChannels)
+            return std::nullopt;
+
+        if (mode == Mode::PitchBend) {
+            if (baseChannel + numSlots * numOutputChannels - 1 > 16)
+                return std::nullopt;
+            return Destination{ baseChannel + slot + outputChannel * numSlots, 0 };
+        }
+
+        const int maxController = mode == Mode::ControlChange14Bit ? 31 : 119; // 14-bit LSBs are on 32-63
+        if (baseController + numSlots - 1 > maxController || baseChannel + numOutputChannels - 1 > 16)
+            return std::nullopt;
+        return Destination{ baseChannel + outputChannel, baseController + slot };
+    }
+
+    /// The next value is sent whatever the threshold and interval
+    void reset() {
+        lastValue = -1;
+    }
+
+    /// `channel` is 1 to 16
+    template <typename AddMessage>
+    void process(const double* values, int numSamples, AddMessage&& addMessage,
+                 Mode mode, int channel, int controller, int threshold, int minInterval) {
+        if (mode != lastMode || channel != lastChannel || controller != lastController) {
+            reset(); // always send the current value after a change of destination
+            lastMode = mode;
+            lastChannel = channel;
+            lastController = controller;
+        }
+
+        const int maxValue = mode == Mode::ControlChange ? 127 : 16383;
+        if (mode == Mode::ControlChange14Bit)
+            controller = std::min(controller, 31);
+
+        const auto channelBits = static_cast<uint8_t>(std::clamp(channel, 1, 16) - 1);
+        const auto controllerByte = static_cast<uint8_t>(controller & 127);
+
+        for (int i = 0; i < numSamples; i++) {
+            const double normalised = (std::clamp(values[i], -1.0, 1.0) + 1.0) * 0.5;
+            const int value = static_cast<int>(std::lround(normalised * maxValue));
+
+            if (samplesSinceMessage < minInterval)
+                samplesSinceMessage++;
+
+            if (lastValue >= 0 && (std::abs(value - lastValue) < threshold || samplesSinceMessage < minInterval))
+                continue;
+            lastValue = value;
+            samplesSinceMessage = 0;
+
+            const auto msb = static_cast<uint8_t>(value >> 7);
+            const auto lsb = static_cast<uint8_t>(value & 127);
+
+            switch (mode) {
+                case Mode::ControlChange: {
+                    const uint8_t message[] = { static_cast<uint8_t>(0xb0 | channelBits), controllerByte, lsb };
+                    addMessage(message, 3, i);
+                    break;
+                }
+                case Mode::ControlChange14Bit: {
+                    const uint8_t coarse[] = { static_cast<uint8_t>(0xb0 | channelBits), controllerByte, msb };
+                    const uint8_t fine[] = { static_cast<uint8_t>(0xb0 | channelBits), static_cast<uint8_t>(controllerByte + 32), lsb };
+                    addMessage(coarse, 3, i);
+                    addMessage(fine, 3, i);
+                    break;
+                }
+                case Mode::PitchBend: {
+                    const uint8_t message[] = { static_cast<uint8_t>(0xe0 | channelBits), lsb, msb };
+                    addMessage(message, 3, i);
+                    break;
+                }
+            }
+        }
+    }
+
+private:
+    int lastValue = -1;
+    int samplesSinceMessage = 0;
+    Mode lastMode = Mode::ControlChange;
+    int lastChannel = 0;
+    int lastController = -1;
+};
@@ -0,0 +1,426 @@
+#include "NativeExpression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+struct MathFunction {
+    const char* name;
+    double (*fn1)(double);
+    double (*fn2)(double, double);
+};
+
+// Pure functions of the Lua math library, with Lua 5.1 / LuaJIT semantics
+const MathFunction mathFunctions[] = {
+    { "abs",   [](double x) { return std::fabs(x); },  nullptr },
+    { "sin",   [](double x) { return std::sin(x); },   nullptr },
+    { "cos",   [](double x) { return std::cos(x); },   nullptr },
+    { "tan",   [](double x) { return std::tan(x); },   nullptr },
+    { "asin",  [](double x) { return std::asin(x); },  nullptr },
+    { "acos",  [](double x) { return std::acos(x); },  nullptr },
+    { "atan",  [](double x) { return std::atan(x); },  nullptr },
+    { "sinh",  [](double x) { return std::sinh(x); },  nullptr },
+    { "cosh",  [](double x) { return std::cosh(x); },  nullptr },
+    { "tanh",  [](double x) { return std::tanh(x); },  nullptr },
+    { "exp",   [](double x) { return std::exp(x); },   nullptr },
+    { "log",   [](double x) { return std::log(x); },   nullptr },
+    { "log10", [](double x) { return std::log10(x); }, nullptr },
+    { "sqrt",  [](double x) { return std::sqrt(x); },  nullptr },
+    { "floor", [](double x) { return std::floor(x); }, nullptr },
+    { "ceil",  [](double x) { return std::ceil(x); },  nullptr },
+    { "deg",   [](double x) { return x * (180.0 / 3.14159265358979323846); }, nullptr },
+    { "rad",   [](double x) { return x * (3.14159265358979323846 / 180.0); }, nullptr },
+    { "atan2", nullptr, [](double y, double x) { return std::atan2(y, x); } },
+    { "pow",   nullptr, [](double x, double y) { return std::pow(x, y); } },
+    { "fmod",  nullptr, [](double x, double y) { return std::fmod(x, y); } },
+    { "min",   nullptr, [](double x, double y) { return y < x ? y : x; } },
+    { "max",   nullptr, [](double x, double y) { return y > x ? y : x; } },
+};
+
+double luaMod(double a, double b) {
+    return a - std::floor(a / b) * b;
+}
+
+} // namespace
+
+/// Recursive descent parser following Lua operator precedence:
+///   expr    := mulexp { ('+' | '-') mulexp }
+///   mulexp  := unary { ('*' | '/' | '%') unary }
+///   unary   := '-' unary | power
+///   power   := primary [ '^' unary ]
+///   primary := number | variable | 'math.' name [ '(' args ')' ] | '(' expr ')'
+class NativeExpressionParser {
+public:
+    NativeExpressionParser(const char* str, const std::vector<std::string>& names, NativeExpression& target)
+        : p(str), variableNames(names), plan(target) {}
+
+    bool parseScript() {
+        skipSpace();
+        if (!acceptKeyword("return"))
+            return false;
+        if (!parseExpression())
+            return false;
+        skipSpace();
+        if (*p == ';')
+            p++;
+        skipSpace();
+        return ok && *p == '\0';
+    }
+
+private:
+    const char* p;
+    const std::vector<std::string>& variableNames;
+    NativeExpression& plan;
+    bool ok = true;
+
+    using Op = NativeExpression::Op;
+    using Instruction = NativeExpression::Instruction;
+
+    void skipSpace() {
+        for (;;) {
+            while (std::isspace(static_cast<unsigned char>(*p)))
+                p++;
+
+            if (p[0] == '-' && p[1] == '-') {
+                if (p[2] == '[') { // long comments are left to Lua
+                    ok = false;
+                    return;
+                }
+                while (*p != '\0' && *p != '\n')
+                    p++;
+                continue;
+            }
+            return;
+        }
+    }
+
+    static bool isNameChar(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    std::string readName() {
+        skipSpace();
+        const char* start = p;
+        if (!std::isalpha(static_cast<unsigned char>(*p)) && *p != '_')
+            return {};
+        while (isNameChar(*p))
+            p++;
+        return std::string(start, p);
+    }
+
+    bool acceptKeyword(const char* keyword) {
+        size_t len = std::strlen(keyword);
+        if (std::strncmp(p, keyword, len) != 0 || isNameChar(p[len]))
+            return false;
+        p += len;
+        return true;
+    }
+
+    bool accept(char c) {
+        skipSpace();
+        if (*p != c)
+            return false;
+        p++;
+        return true;
+    }
+
+    // Emits an instruction, folding it into a constant if all of its operands are constant
+    void emit(const Instruction& ins, int numOperands) {
+        auto& code = plan.instructions;
+        bool foldable = numOperands > 0 && static_cast<int>(code.size()) >= numOperands
+            && std::all_of(code.end() - numOperands, code.end(),
+                           [](const Instruction& i) { return i.op == Op::Constant; });
+
+        if (!foldable) {
+            code.push_back(ins);
+            return;
+        }
+
+        const size_t first = code.size() - static_cast<size_t>(numOperands);
+        double a = code[first].constant;
+        double b = numOperands == 2 ? code.back().constant : 0.0;
+        code.resize(first);
+
+        Instruction folded{ Op::Constant };
+        folded.constant = apply(ins, a, b);
+        code.push_back(folded);
+    }
+
+    static double apply(const Instruction& ins, double a, double b) {
+        switch (ins.op) {
+            case Op::Add:   return a + b;
+            case Op::Sub:   return a - b;
+            case Op::Mul:   return a * b;
+            case Op::Div:   return a / b;
+            case Op::Mod:   return luaMod(a, b);
+            case Op::Pow:   return std::pow(a, b);
+            case Op::Neg:   return -a;
+            case Op::Call1: return ins.fn1(a);
+            case Op::Call2: return ins.fn2(a, b);
+            case Op::Constant:
+            case Op::Variable:
+                break; // not emitted with operands
+        }
+        return 0.0;
+    }
+
+    bool parseExpression() {
+        if (!parseMul())
+            return false;
+        for (;;) {
+            skipSpace();
+            if (*p == '+' || (*p == '-' && p[1] != '-')) {
+                Op op = *p == '+' ? Op::Add : Op::Sub;
+                p++;
+                if (!parseMul())
+                    return false;
+                emit({ op }, 2);
+            }
+            else {
+                return ok;
+            }
+        }
+    }
+
+    bool parseMul() {
+        if (!parseUnary())
+            return false;
+        for (;;) {
+            skipSpace();
+            if (*p == '*' || *p == '/' || *p == '%') {
+                Op op = *p == '*' ? Op::Mul : *p == '/' ? Op::Div : Op::Mod;
+                p++;
+                if (!parseUnary())
+                    return false;
+                emit({ op }, 2);
+            }
+            else {
+                return ok;
+            }
+        }
+    }
+
+    bool parseUnary() {
+        skipSpace();
+        if (*p == '-' && p[1] != '-') {
+            p++;
+            if (!parseUnary())
+                return false;
+            emit({ Op::Neg }, 1);
+            return true;
+        }
+        return parsePower();
+    }
+
+    bool parsePower() {
+        if (!parsePrimary())
+            return false;
+        if (accept('^')) {
+            if (!parseUnary())
+                return false;
+            emit({ Op::Pow }, 2);
+        }
+        return ok;
+    }
+
+    bool parsePrimary() {
+        skipSpace();
+        if (!ok)
+            return false;
+
+        if (accept('(')) {
+            if (!parseExpression() || !accept(')'))
+                return false;
+            return true;
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(*p))
+            || (*p == '.' && std::isdigit(static_cast<unsigned char>(p[1]))))
+            return parseNumber();
+
+        std::string name = readName();
+        if (name.empty())
+            return false;
+
+        if (name == "math")
+            return parseMath();
+
+        auto it = std::find(variableNames.begin(), variableNames.end(), name);
+        if (it == variableNames.end())
+            return false;
+
+        Instruction ins{ Op::Variable };
+        ins.variable = static_cast<int>(it - variableNames.begin());
+        emit(ins, 0);
+        return true;
+    }
+
+    bool parseNumber() {
+        char* end = nullptr;
+        double value = std::strtod(p, &end);
+        if (end == p || isNameChar(*end)) // e.g. LuaJIT 64 bit integer literals
+            return false;
+        p = end;
+
+        Instruction ins{ Op::Constant };
+        ins.constant = value;
+        emit(ins, 0);
+        return true;
+    }
+
+    bool parseMath() {
+        if (!accept('.'))
+            return false;
+        std::string name = readName();
+
+        Instruction constant{ Op::Constant };
+        if (name == "pi") {
+            constant.constant = 3.14159265358979323846;
+            emit(constant, 0);
+            return true;
+        }
+        if (name == "huge") {
+            constant.constant = HUGE_VAL;
+            emit(constant, 0);
+            return true;
+        }
+
+        const MathFunction* fn = nullptr;
+        for (const auto& f : mathFunctions)
+            if (name == f.name)
+                fn = &f;
+        if (fn == nullptr || !accept('('))
+            return false;
+
+        const bool variadic = name == "min" || name == "max";
+        Instruction call{ fn->fn1 != nullptr ? Op::Call1 : Op::Call2 };
+        call.fn1 = fn->fn1;
+        call.fn2 = fn->fn2;
+
+        int numArgs = 0;
+        do {
+            if (!parseExpression())
+                return false;
+            numArgs++;
+            // math.min and math.max are variadic, chain them pairwise
+            if (variadic && numArgs >= 2)
+                emit(call, 2);
+        } while (accept(','));
+        if (!accept(')'))
+            return false;
+
+        if (variadic)
+            return true;
+        if (fn->fn1 != nullptr && numArgs == 1) {
+            emit(call, 1);
+            return true;
+        }
+        if (fn->fn2 != nullptr && numArgs == 2) {
+            emit(call, 2);
+            return true;
+        }
+        return false;
+    }
+};
+
+std::optional<NativeExpression> NativeExpression::parse(const char* str, const std::vector<std::string>& variableNames) {
+    NativeExpression plan;
+    NativeExpressionParser parser(str, variableNames, plan);
+    if (!parser.parseScript())
+        return std::nullopt;
+
+    // Compute stack depth needed for evaluation
+    int depth = 0;
+    for (const auto& ins : plan.instructions) {
+        switch (ins.op) {
+            case Op::Constant:
+            case Op::Variable:
+                depth++;
+                break;
+            case Op::Neg:
+            case Op::Call1:
+                break;
+            case Op::Add:
+            case Op::Sub:
+            case Op::Mul:
+            case Op::Div:
+            case Op::Mod:
+            case Op::Pow:
+            case Op::Call2:
+                depth--;
+                break;
+        }
+        plan.maxStackDepth = std::max(plan.maxStackDepth, depth);
+    }
+
+    if (depth != 1)
+        return std::nullopt;
+
+    plan.stack.resize(static_cast<size_t>(plan.maxStackDepth) * CHUNK_SIZE);
+    return plan;
+}
+
+double NativeExpression::evaluate(const ExpressionVariable* variables) {
+    double* st = stack.data();
+    int top = -1;
+
+    for (const auto& ins : instructions) {
+        switch (ins.op) {
+            case Op::Constant: st[++top] = ins.constant; break;
+            case Op::Variable: st[++top] = variables[ins.variable].value; break;
+            case Op::Add:      st[top - 1] = st[top - 1] + st[top]; top--; break;
+            case Op::Sub:      st[top - 1] = st[top - 1] - st[top]; top--; break;
+            case Op::Mul:      st[top - 1] = st[top - 1] * st[top]; top--; break;
+            case Op::Div:      st[top - 1] = st[top - 1] / st[top]; top--; break;
+            case Op::Mod:      st[top - 1] = luaMod(st[top - 1], st[top]); top--; break;
+            case Op::Pow:      st[top - 1] = std::pow(st[top - 1], st[top]); top--; break;
+            case Op::Neg:      st[top] = -st[top]; break;
+            case Op::Call1:    st[top] = ins.fn1(st[top]); break;
+            case Op::Call2:    st[top - 1] = ins.fn2(st[top - 1], st[top]); top--; break;
+        }
+    }
+
+    return st[top];
+}
+
+void NativeExpression::evaluateBlock(const ExpressionVariable* variables, double* results, int numSamples) {
+    for (int offset = 0; offset < numSamples; offset += CHUNK_SIZE) {
+        const int n = std::min(CHUNK_SIZE, numSamples - offset);
+        int top = -1;
+
+        for (const auto& ins : instructions) {
+            if (ins.op == Op::Constant || ins.op == Op::Variable)
+                top++;
+
+            double* b = stack.data() + static_cast<size_t>(top) * CHUNK_SIZE;
+            double* a = top > 0 ? b - CHUNK_SIZE : b; // left operand of binary operators
+
+            switch (ins.op) {
+                case Op::Constant:
+                    std::fill(b, b + n, ins.constant);
+                    break;
+                case Op::Variable: {
+                    const auto& v = variables[ins.variable];
+                    for (int i = 0; i < n; i++)
+                        b[i] = v.value + v.increment * (offset + i);
+                    break;
+                }
+                case Op::Add:   for (int i = 0; i < n; i++) a[i] = a[i] + b[i]; top--; break;
+                case Op::Sub:   for (int i = 0; i < n; i++) a[i] = a[i] - b[i]; top--; break;
+                case Op::Mul:   for (int i = 0; i < n; i++) a[i] = a[i] * b[i]; top--; break;
+                case Op::Div:   for (int i = 0; i < n; i++) a[i] = a[i] / b[i]; top--; break;
+                case Op::Mod:   for (int i = 0; i < n; i++) a[i] = luaMod(a[i], b[i]); top--; break;
+                case Op::Pow:   for (int i = 0; i < n; i++) a[i] = std::pow(a[i], b[i]); top--; break;
+                case Op::Neg:   for (int i = 0; i < n; i++) b[i] = -b[i]; break;
+                case Op::Call1: for (int i = 0; i < n; i++) b[i] = ins.fn1(b[i]); break;
+                case Op::Call2: for (int i = 0; i < n; i++) a[i] = ins.fn2(a[i], b[i]); top--; break;
+            }
+        }
+
+        std::copy(stack.data(), stack.data() + n, results + offset);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// Numeric script input. Its value advances by `increment` every sample of a block.
+struct ExpressionVariable {
+    double value = 0.0;
+    double increment = 0.0;
+};
+
+/// Flattened evaluation plan for scripts of the form `return <expression>`, where the
+/// expression only uses number literals, registered variables, arithmetic operators and
+/// the pure functions of the `math` library. Blocks are evaluated one instruction at a
+/// time over fixed size chunks, so the inner loops are simple array loops.
+class NativeExpression {
+public:
+    /// Returns std::nullopt if the script is outside of the supported grammar
+    static std::optional<NativeExpression> parse(const char* str, const std::vector<std::string>& variableNames);
+
+    double evaluate(const ExpressionVariable* variables);
+
+    void evaluateBlock(const ExpressionVariable* variables, double* results, int numSamples);
+
+    static constexpr int CHUNK_SIZE = 64;
+
+private:
+    enum class Op : uint8_t {
+        Constant,
+        Variable,
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Mod,
+        Pow,
+        Neg,
+        Call1,
+        Call2
+    };
+
+    struct Instruction {
+        Op op;
+        int variable = 0;
+        double constant = 0.0;
+        double (*fn1)(double) = nullptr;
+        double (*fn2)(double, double) = nullptr;
+    };
+
+    std::vector<Instruction> instructions;
+    std::vector<double> stack;
+    int maxStackDepth = 0;
+
+    friend class NativeExpressionParser;
+};
@@ -0,0 +1,117 @@
+#include "OutputChain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void OutputChain::prepare(double newSampleRate) {
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void OutputChain::reset() {
+    hasPrevious = false;
+    previous = 0.0;
+    rampTarget = 0.0;
+    rampStep = 0.0;
+    rampRemaining = 0;
+}
+
+void OutputChain::process(double* values, int numSamples, const OutputChainSettings& settings) {
+    if (numSamples <= 0)
+        return;
+
+    sanitise(values, numSamples);
+
+    if (!hasPrevious) {
+        previous = values[0];
+        hasPrevious = true;
+    }
+
+    if (settings.slewRate > 0.0)
+        slewLimit(values, numSamples, settings.slewRate / sampleRate);
+
+    const double smoothingSamples = std::max(1.0, settings.smoothingTime * sampleRate);
+    switch (settings.smoothing) {
+        case OutputChainSettings::Smoothing::Off:
+            break;
+        case OutputChainSettings::Smoothing::OnePole:
+            smoothOnePole(values, numSamples, 1.0 - std::exp(-1.0 / smoothingSamples));
+            break;
+        case OutputChainSettings::Smoothing::LinearRamp:
+            smoothLinearRamp(values, numSamples, static_cast<int>(smoothingSamples));
+            break;
+    }
+
+    previous = values[numSamples - 1];
+
+    // Parameters hold -1, 1 and 0 exactly at their defaults, the tolerance only avoids exact float comparisons
+    constexpr double tolerance = 1e-9;
+    if (std::abs(settings.rangeMin + 1.0) > tolerance || std::abs(settings.rangeMax - 1.0) > tolerance
+        || std::abs(settings.curve) > tolerance)
+        mapRange(values, numSamples, settings.rangeMin, settings.rangeMax, settings.curve);
+}
+
+void OutputChain::sanitise(double* values, int numSamples) {
+    // Comparisons with NaN are false, so NaN, Inf and denormals all fail the range test.
+    // Relies on IEEE semantics, this file must not be built with -ffinite-math-only.
+    constexpr double smallest = std::numeric_limits<double>::min();
+    constexpr double largest = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < numSamples; i++) {
+        const double magnitude = std::abs(values[i]);
+        const double value = (magnitude >= smallest && magnitude <= largest) ? values[i] : 0.0;
+        values[i] = std::min(1.0, std::max(-1.0, value));
+    }
+}
+
+void OutputChain::mapRange(double* values, int numSamples, double rangeMin, double rangeMax, double curve) {
+    // Rational curve u * (1 + c) / (u * (1 + c) + (1 - u) * (1 - c)), linear for c = 0
+    const double c = std::min(0.99, std::max(-0.99, curve));
+    const double a = 1.0 + c;
+    const double b = 1.0 - c;
+    const double span = rangeMax - rangeMin;
+
+    for (int i = 0; i < numSamples; i++) {
+        const double u = (values[i] + 1.0) * 0.5;
+        const double curved = u * a / (u * a + (1.0 - u) * b);
+        values[i] = rangeMin + curved * span;
+    }
+}
+
+void OutputChain::slewLimit(double* values, int numSamples, double maxStep) {
+    double y = previous;
+    for (int i = 0; i < numSamples; i++) {
+        y += std::min(maxStep, std::max(-maxStep, values[i] - y));
+        values[i] = y;
+    }
+    previous = y;
+}
+
+void OutputChain::smoothOnePole(double* values, int numSamples, double coefficient) {
+    double y = previous;
+    for (int i = 0; i < numSamples; i++) {
+        y += coefficient * (values[i] - y);
+        values[i] = y;
+    }
+    previous = y;
+}
+
+void OutputChain::smoothLinearRamp(double* values, int numSamples, int rampLength) {
+    double y = previous;
+    for (int i = 0; i < numSamples; i++) {
+        // The target is only taken from the input once the previous ramp finished, so every
+        // ramp is linear and reaches its target instead of restarting on each new value
+        if (rampRemaining == 0) {
+            rampTarget = values[i];
+            rampRemaining = rampLength;
+            rampStep = (rampTarget - y) / rampLength;
+        }
+
+        y += rampStep;
+        if (--rampRemaining == 0)
+            y = rampTarget;
+        values[i] = y;
+    }
+    previous = y;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+/// Settings of the OutputChain, shared by every slot and channel
+struct OutputChainSettings {
+    enum class Smoothing {
+        Off = 0,
+        OnePole,
+        LinearRamp
+    };
+
+    double slewRate = 0.0; // maximum change per second, 0 disables the limit
+    Smoothing smoothing = Smoothing::Off;
+    double smoothingTime = 0.05; // seconds, time constant or ramp length
+    double rangeMin = -1.0;      // output for a script result of -1
+    double rangeMax = 1.0;       // output for a script result of 1
+    double curve = 0.0;          // -1 to 1, bends the mapping towards rangeMin or rangeMax, 0 is linear
+};
+
+/// Native post-processing of a block of script results, in place:
+/// sanitise (NaN, Inf and denormals become 0, then clamp to [-1, 1]), slew limit, smooth,
+/// then map to the range with the curve. The stateless stages are branch-free loops the
+/// compiler vectorises; slew limiting and smoothing depend on the previous sample.
+class OutputChain {
+public:
+    void prepare(double newSampleRate);
+
+    /// Forgets the previous output, the next block starts at its first value
+    void reset();
+
+    void process(double* values, int numSamples, const OutputChainSettings& settings);
+
+    static void sanitise(double* values, int numSamples);
+    static void mapRange(double* values, int numSamples, double rangeMin, double rangeMax, double curve);
+
+private:
+    void slewLimit(double* values, int numSamples, double maxStep);
+    void smoothOnePole(double* values, int numSamples, double coefficient);
+    // Retargets every `rampLength` samples to the input at that sample, i.e. linear interpolation
+    // of the input sampled at that interval, one ramp behind it
+    void smoothLinearRamp(double* values, int numSamples, int rampLength);
+
+    double sampleRate = 44100.0;
+    bool hasPrevious = false;
+    double previous = 0.0; // last output of the slew limiter and smoother, before mapping
+
+    // Linear ramp state
+    double rampTarget = 0.0;
+    double rampStep = 0.0;
+    int rampRemaining = 0;
+};
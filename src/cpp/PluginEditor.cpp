@@ -1,8 +1,6 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-
-#include <lua.hpp>
-#include <cassert>
+#include "WebResourceProvider.h"
 
 juce::var valueTreeToVar(const juce::ValueTree& tree)
 {
@@ -16,7 +14,7 @@ juce::var valueTreeToVar(const juce::ValueTree& tree)
 AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAudioProcessor& p)
     :   AudioProcessorEditor (&p),
         processorRef (p),
-        lastOpenedFile (std::nullopt),
+        lastOpenedFile (p.getWatchedScriptFile()),
         webBrowser (juce::WebBrowserComponent::Options{}
                         .withBackend (juce::WebBrowserComponent::Options::Backend::webview2)
                         .withWinWebView2Options (juce::WebBrowserComponent::Options::WinWebView2{}
@@ -60,11 +58,12 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
                                 fileChooser->launchAsync(fileChooserFlags, [this](const juce::FileChooser& chooser) {
                                     juce::File file = chooser.getResult();
                                     if (file.existsAsFile()) {
+                                        const juce::String source = file.loadFileAsString();
                                         this->webBrowser.emitEventIfBrowserIsVisible(
                                             "fileSelect",
-                                            juce::var{juce::Array<juce::var>{file.getFileName(), file.loadFileAsString()}}
+                                            juce::var{juce::Array<juce::var>{file.getFileName(), source}}
                                         );
-                                        lastOpenedFile = file; // Store the last opened file
+                                        setLastOpenedFile(file, source); // Store the last opened file
                                     }
                                 });
 
@@ -78,9 +77,10 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
 
                                 if (lastOpenedFile && useLastOpenedFile) {
                                     lastOpenedFile->replaceWithText(fileData);
+                                    setLastOpenedFile(*lastOpenedFile, fileData);
                                     this->webBrowser.emitEventIfBrowserIsVisible(
                                         "fileSelect",
-                                        juce::var{juce::Array<juce::var>{lastOpenedFile->getFileName(), lastOpenedFile->loadFileAsString()}}
+                                        juce::var{juce::Array<juce::var>{lastOpenedFile->getFileName(), fileData}}
                                     );
                                 }
                                 else {
@@ -99,11 +99,11 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
                                         file.replaceWithText(fileData);
 
                                         if (file.existsAsFile()) {
-                                            lastOpenedFile = file;
+                                            setLastOpenedFile(file, fileData);
 
                                             this->webBrowser.emitEventIfBrowserIsVisible(
                                                 "fileSelect",
-                                                juce::var{juce::Array<juce::var>{file.getFileName(), file.loadFileAsString()}}
+                                                juce::var{juce::Array<juce::var>{file.getFileName(), fileData}}
                                             );
                                         }
                                     });
@@ -113,6 +113,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
                         .withNativeFunction("resetLastOpenedFile", // This function is called when presets are loaded
                             [this](const juce::Array<juce::var>& args, juce::WebBrowserComponent::NativeFunctionCompletion completion) {
                                 lastOpenedFile = std::nullopt;
+                                this->processorRef.unwatchScriptFile();
                             }
                         )
                         .withNativeFunction("compile",
@@ -120,14 +121,79 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
                                 if (args[0].isUndefined())
                                     return;
 
-                                /// TODO: see if theres a better alternative to doing this?
+                                // The processor only holds the lock for a swap, so this does not block
                                 const juce::String& script = args[0];
-                                std::thread([this, script] {
-                                    std::scoped_lock lock(this->processorRef.luaEnvCompileMutex);
-                                    this->processorRef.luaEnvCompileString = script.toStdString();
-                                }).detach();
+                                std::optional<std::string> packagePath;
+                                if (lastOpenedFile)
+                                    packagePath = lastOpenedFile->getParentDirectory().getFullPathName().toStdString();
+
+                                int slot = args.size() > 1 ? static_cast<int>(args[1]) : 0;
+                                slot = juce::jlimit(0, AudioPluginAudioProcessor::NUM_SCRIPT_SLOTS - 1, slot);
+                                this->processorRef.hotReloadSlot = slot;
+                                this->processorRef.submitScript(script.toStdString(), packagePath, slot);
+
+                                scriptLintWorker.lint(script.toStdString(), true);
                             }
                         )
+                        .withNativeFunction("lint",
+                            [this](const juce::Array<juce::var>& args, juce::WebBrowserComponent::NativeFunctionCompletion completion) {
+                                if (args[0].isUndefined())
+                                    return;
+
+                                // Debounced, called on every edit
+                                scriptLintWorker.lint(args[0].toString().toStdString());
+                            }
+                        )
+                        .withNativeFunction("setRecording",
+                            [this](const juce::Array<juce::var>& args, juce::WebBrowserComponent::NativeFunctionCompletion completion) {
+                                if (! static_cast<bool>(args[0])) {
+                                    processorRef.stopRecording();
+                                    completion(juce::var());
+                                    return;
+                                }
+
+                                auto directory = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                                                     .getChildFile("Formulizer Controller/Recordings");
+                                directory.createDirectory();
+                                auto file = directory.getChildFile(juce::Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S") + ".fzrec");
+
+                                // Returns the file path, or an error message
+                                if (auto err = processorRef.startRecording(file))
+                                    completion(juce::var{juce::Array<juce::var>{false, juce::String(*err)}});
+                                else
+                                    completion(juce::var{juce::Array<juce::var>{true, file.getFullPathName()}});
+                            }
+                        )
+                        .withNativeFunction("getPresetList",
+                            [this](const juce::Array<juce::var>& args, juce::WebBrowserComponent::NativeFunctionCompletion completion) {
+                                juce::Array<juce::var> send;
+
+                                for (const auto& preset : *this->processorRef.presetLibrary->getPresets()) {
+                                    juce::DynamicObject::Ptr entry = new juce::DynamicObject();
+                                    entry->setProperty("name", preset.name);
+                                    entry->setProperty("path", preset.file.getFullPathName());
+                                    entry->setProperty("tags", juce::var(juce::Array<juce::var>(preset.tags.begin(), preset.tags.size())));
+                                    send.add(juce::var(entry.get()));
+                                }
+
+                                return completion(juce::var(send));
+                            })
+                        .withNativeFunction("loadPreset",
+                            [this](const juce::Array<juce::var>& args, juce::WebBrowserComponent::NativeFunctionCompletion completion) {
+                                // Presets are identified by path, indices change when the library is rescanned
+                                auto preset = this->processorRef.loadPreset(juce::File(args[0].toString()));
+                                if (!preset)
+                                    return completion(juce::var());
+
+                                lastOpenedFile = std::nullopt;
+                                this->processorRef.unwatchScriptFile();
+
+                                this->webBrowser.emitEventIfBrowserIsVisible(
+                                    "fileSelect",
+                                    juce::var{juce::Array<juce::var>{preset->name + ".lua", juce::String(preset->source)}}
+                                );
+                                return completion(juce::var());
+                            })
                         .withNativeFunction("requestOutputLog",
                             [this](const juce::Array<juce::var>& args, juce::WebBrowserComponent::NativeFunctionCompletion completion) {
                                 juce::Array<juce::var> send;
@@ -164,54 +230,36 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
                             [this](const juce::Array<juce::var>& args, juce::WebBrowserComponent::NativeFunctionCompletion completion) {
                                 this->processorRef.luaOutputLog.clearFlag.store(true);
                             })
-                        .withResourceProvider ( /// TODO: Write ResourceProvider somewhere else
-                            [](const juce::String& resourceName) -> std::optional<juce::WebBrowserComponent::Resource>
-                            {
-                                juce::String path = juce::String(SOURCE_DIR) + "/src/js/dist" + resourceName;
-                                juce::File file(path);
-
-                                if (file.existsAsFile())
-                                {
-                                    juce::String html = file.loadFileAsString();
-                                    size_t len = html.getNumBytesAsUTF8();          // get length in bytes (no null terminator)
-                                    const char* data = html.toRawUTF8();            // get UTF8 pointer
-
-                                    // Create vector of bytes from UTF8 data
-                                    std::vector<std::byte> bytes(reinterpret_cast<const std::byte*>(data),
-                                                                reinterpret_cast<const std::byte*>(data) + len);
-
-                                    juce::String mimeType = "text/plain";
-                                    if (file.getFileExtension() == ".html")
-                                        mimeType = "text/html";
-                                    else if (file.getFileExtension() == ".js")
-                                        mimeType = "application/javascript";
-                                    else if (file.getFileExtension() == ".css")
-                                        mimeType = "text/css";
-
-                                    return juce::WebBrowserComponent::Resource{ std::move(bytes), mimeType };
-                                }
-
-                                return std::nullopt;
-                            }))
+                        .withResourceProvider (getWebResource))
 {
     juce::ignoreUnused (processorRef);
 
-/// TODO: Remove this
-    lua_State* L = luaL_newstate(); // Test lua state working
-    luaL_openlibs (L);
-    assert(luaL_dostring(L, "return 'index.html'") == LUA_OK);
-    assert(lua_isstring(L, -1));
-    const char* result = lua_tostring(L, -1);
-    juce::String resultStr(result);
-    lua_close(L);
+    processorRef.scriptReloaded.addChangeListener(this);
+
+    scriptLintWorker.onResult = [this](const std::vector<LintWarning>& warnings) {
+        juce::Array<juce::var> send;
+        for (const auto& warning : warnings) {
+            juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+            obj->setProperty("line", warning.line);
+            obj->setProperty("column", warning.column);
+            obj->setProperty("length", warning.length);
+            obj->setProperty("severity", static_cast<int>(warning.severity));
+            obj->setProperty("message", juce::String(warning.message));
+            send.add(juce::var(obj.get()));
+        }
+
+        juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<AudioPluginAudioProcessorEditor>(this), send] {
+            if (safeThis != nullptr)
+                safeThis->webBrowser.emitEventIfBrowserIsVisible("lintUpdate", juce::var(send));
+        });
+    };
 
     addAndMakeVisible (webBrowser);
 #ifndef VITE_DEV
-    webBrowser.goToURL (juce::WebBrowserComponent::getResourceProviderRoot() + resultStr);
+    webBrowser.goToURL (juce::WebBrowserComponent::getResourceProviderRoot() + "index.html");
 #else
     webBrowser.goToURL ("http://localhost:5173/");
 #endif
-    DBG(SOURCE_DIR);
 
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
@@ -220,6 +268,24 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
 
 AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor()
 {
+    processorRef.scriptReloaded.removeChangeListener(this);
+}
+
+void AudioPluginAudioProcessorEditor::setLastOpenedFile(const juce::File& file, const juce::String& source)
+{
+    lastOpenedFile = file;
+    processorRef.watchScriptFile(file, source);
+}
+
+void AudioPluginAudioProcessorEditor::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    if (!lastOpenedFile)
+        return;
+
+    this->webBrowser.emitEventIfBrowserIsVisible(
+        "fileSelect",
+        juce::var{juce::Array<juce::var>{lastOpenedFile->getFileName(), processorRef.getReloadedSource()}}
+    );
 }
 
 //==============================================================================
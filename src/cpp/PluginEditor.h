@@ -1,9 +1,11 @@
 #pragma once
 
 #include "PluginProcessor.h"
+#include "ScriptLintWorker.h"
 
 //==============================================================================
-class AudioPluginAudioProcessorEditor final : public juce::AudioProcessorEditor
+class AudioPluginAudioProcessorEditor final : public juce::AudioProcessorEditor,
+                                              private juce::ChangeListener
 {
 public:
     explicit AudioPluginAudioProcessorEditor (AudioPluginAudioProcessor&);
@@ -19,7 +21,13 @@ private:
     AudioPluginAudioProcessor& processorRef;
     std::unique_ptr<juce::FileChooser> fileChooser;
     juce::WebBrowserComponent webBrowser;
-    std::optional<juce::File> lastOpenedFile;
+    std::optional<juce::File> lastOpenedFile; // hot reloaded by the processor when edited elsewhere
+    ScriptLintWorker scriptLintWorker{{"t", "ch", "input"}}; // names the processor defines for scripts
+
+    void setLastOpenedFile(const juce::File& file, const juce::String& source);
+
+    // Shows the source after the processor hot reloaded lastOpenedFile
+    void changeListenerCallback(juce::ChangeBroadcaster*) override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessorEditor)
 };
@@ -24,9 +24,122 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
                 1.0f,
                 0.0f
             ),
+            std::make_unique<juce::AudioParameterFloat>("output3",
+                "Output3",
+                -1.0f,
+                1.0f,
+                0.0f
+            ),
+            std::make_unique<juce::AudioParameterFloat>("output4",
+                "Output4",
+                -1.0f,
+                1.0f,
+                0.0f
+            ),
+            std::make_unique<juce::AudioParameterFloat>("outputRight",
+                "Output Right",
+                -1.0f,
+                1.0f,
+                0.0f
+            ),
+            std::make_unique<juce::AudioParameterFloat>("output2Right",
+                "Output2 Right",
+                -1.0f,
+                1.0f,
+                0.0f
+            ),
+            std::make_unique<juce::AudioParameterFloat>("output3Right",
+                "Output3 Right",
+                -1.0f,
+                1.0f,
+                0.0f
+            ),
+            std::make_unique<juce::AudioParameterFloat>("output4Right",
+                "Output4 Right",
+                -1.0f,
+                1.0f,
+                0.0f
+            ),
+            std::make_unique<juce::AudioParameterChoice>("evaluationMode",
+                "Evaluation Mode",
+                juce::StringArray{ "Per Frame", "Per Channel" },
+                0
+            ),
+            std::make_unique<juce::AudioParameterChoice>("outputMode",
+                "Output Mode",
+                juce::StringArray{ "Parameter", "MIDI CC", "MIDI CC (14-bit)", "Pitch Bend" },
+                0
+            ),
+            std::make_unique<juce::AudioParameterInt>("midiChannel",
+                "MIDI Channel",
+                1,
+                16,
+                1
+            ),
+            std::make_unique<juce::AudioParameterInt>("midiController",
+                "MIDI Controller",
+                0,
+                119,
+                1
+            ),
+            std::make_unique<juce::AudioParameterInt>("midiThreshold",
+                "MIDI Threshold",
+                1,
+                64,
+                1
+            ),
+            std::make_unique<juce::AudioParameterFloat>("midiInterval",
+                "MIDI Interval",
+                juce::NormalisableRange<float>(0.0f, 100.0f, 0.0f, 0.5f),
+                5.0f // ms, at most 200 messages per second and output
+            ),
+            std::make_unique<juce::AudioParameterFloat>("slewRate",
+                "Slew Limit",
+                juce::NormalisableRange<float>(0.0f, 100.0f, 0.0f, 0.3f),
+                0.0f
+            ),
+            std::make_unique<juce::AudioParameterChoice>("smoothing",
+                "Smoothing",
+                juce::StringArray{ "Off", "One Pole", "Linear Ramp" },
+                0
+            ),
+            std::make_unique<juce::AudioParameterFloat>("smoothingTime",
+                "Smoothing Time",
+                juce::NormalisableRange<float>(0.001f, 2.0f, 0.0f, 0.3f),
+                0.05f
+            ),
+            std::make_unique<juce::AudioParameterFloat>("rangeMin",
+                "Range Min",
+                -1.0f,
+                1.0f,
+                -1.0f
+            ),
+            std::make_unique<juce::AudioParameterFloat>("rangeMax",
+                "Range Max",
+                -1.0f,
+                1.0f,
+                1.0f
+            ),
+            std::make_unique<juce::AudioParameterFloat>("curve",
+                "Curve",
+                -1.0f,
+                1.0f,
+                0.0f
+            ),
         })
 {
-    paramOutput = dynamic_cast<juce::AudioParameterFloat*>(valueTreeState.getParameter("output"));
+    paramEvaluationMode = dynamic_cast<juce::AudioParameterChoice*>(valueTreeState.getParameter("evaluationMode"));
+    paramOutputMode = dynamic_cast<juce::AudioParameterChoice*>(valueTreeState.getParameter("outputMode"));
+    paramMidiChannel = dynamic_cast<juce::AudioParameterInt*>(valueTreeState.getParameter("midiChannel"));
+    paramMidiController = dynamic_cast<juce::AudioParameterInt*>(valueTreeState.getParameter("midiController"));
+    paramMidiThreshold = dynamic_cast<juce::AudioParameterInt*>(valueTreeState.getParameter("midiThreshold"));
+    paramMidiInterval = dynamic_cast<juce::AudioParameterFloat*>(valueTreeState.getParameter("midiInterval"));
+    paramSlewRate = dynamic_cast<juce::AudioParameterFloat*>(valueTreeState.getParameter("slewRate"));
+    paramSmoothing = dynamic_cast<juce::AudioParameterChoice*>(valueTreeState.getParameter("smoothing"));
+    paramSmoothingTime = dynamic_cast<juce::AudioParameterFloat*>(valueTreeState.getParameter("smoothingTime"));
+    paramRangeMin = dynamic_cast<juce::AudioParameterFloat*>(valueTreeState.getParameter("rangeMin"));
+    paramRangeMax = dynamic_cast<juce::AudioParameterFloat*>(valueTreeState.getParameter("rangeMax"));
+    paramCurve = dynamic_cast<juce::AudioParameterFloat*>(valueTreeState.getParameter("curve"));
     juce::ValueTree guiState("GuiState");
     guiState.setProperty("theme", "light", nullptr);
     guiState.setProperty("tab", "editor", nullptr);
@@ -41,17 +154,49 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
     juce::String teststr = valueTreeState.state.toXmlString();
     juce::String teststr2 = juce::var(dict.get()).toString();
 
-    luaEnv.print_callback = [this](std::string s) {
-        luaOutputLog.add({s, OutputLogMessageType::Text});
-    };
+    for (size_t i = 0; i < slots.size(); i++) {
+        auto slot = std::make_unique<ScriptSlot>();
+
+        juce::String paramId = i == 0 ? juce::String("output") : "output" + juce::String(i + 1);
+        slot->paramOutputs[0] = dynamic_cast<juce::AudioParameterFloat*>(valueTreeState.getParameter(paramId));
+        slot->paramOutputs[1] = dynamic_cast<juce::AudioParameterFloat*>(valueTreeState.getParameter(paramId + "Right"));
+        slots[i] = std::move(slot);
+    }
+
+    // Every compile takes a fresh state, keep enough prepared for all slots of this instance on top of the others
+    luaEnvPool->reserve(LuaEnvLibraries::Sandboxed, NUM_SCRIPT_SLOTS);
+    scriptCompiler.start();
+
+    workerPool->add(slotJobs);
 
     /// TODO: Replace ts
     for (int i = 0; i < 400; i++)
         outputMonitor.add(0);
+
+    presetLibrary->addChangeListener (this);
+
+    scriptFileWatcher.onReload = [this] (const juce::File& file, const juce::String& source, bool scriptChanged) {
+        // Called on the watcher thread, the source is already precompiled
+        if (! scriptChanged) {
+            // Only modules changed: the running script may be unsaved editor content, compile it again as it is
+            resubmitLastScript (hotReloadSlot.load());
+            return;
+        }
+
+        submitScript (source.toStdString(), file.getParentDirectory().getFullPathName().toStdString(), hotReloadSlot.load());
+        {
+            std::scoped_lock lock (watchMutex);
+            reloadedSource = source;
+        }
+        scriptReloaded.sendChangeMessage();
+    };
 }
 
 AudioPluginAudioProcessor::~AudioPluginAudioProcessor()
 {
+    presetLibrary->removeChangeListener (this);
+    workerPool->remove (slotJobs); // waits for workers still evaluating slots of this instance
+    luaEnvPool->release (LuaEnvLibraries::Sandboxed, NUM_SCRIPT_SLOTS);
 }
 
 //==============================================================================
@@ -94,24 +239,71 @@ double AudioPluginAudioProcessor::getTailLengthSeconds() const
 
 int AudioPluginAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    // NB: some hosts don't cope very well if you tell them there are 0 programs,
+    // so this should be at least 1, even if there are no presets.
+    return juce::jmax (1, static_cast<int> (presetLibrary->getPresets()->size()));
 }
 
 int AudioPluginAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram.load();
 }
 
 void AudioPluginAudioProcessor::setCurrentProgram (int index)
 {
-    juce::ignoreUnused (index);
+    auto presets = presetLibrary->getPresets();
+    if (! juce::isPositiveAndBelow (index, static_cast<int> (presets->size()))) {
+        // Hosts restoring a program right after instantiation may be faster than the first scan
+        if (! presetLibrary->hasScanned())
+            pendingProgram.store (index);
+        return;
+    }
+
+    pendingProgram.store (-1);
+    loadPreset ((*presets)[static_cast<size_t> (index)].file);
+}
+
+std::optional<Preset> AudioPluginAudioProcessor::loadPreset (const juce::File& file)
+{
+    auto presets = presetLibrary->getPresets();
+    auto it = std::find_if (presets->begin(), presets->end(), [&file] (const Preset& p) { return p.file == file; });
+    if (it == presets->end())
+        return std::nullopt;
+
+    {
+        std::scoped_lock lock (currentPresetMutex);
+        currentPresetFile = file;
+    }
+
+    // Source is already in memory and its bytecode in the cache, so this does no disk I/O or parsing
+    currentProgram.store (static_cast<int> (std::distance (presets->begin(), it)));
+    submitScript (it->source, file.getParentDirectory().getFullPathName().toStdString()); // modules next to the preset
+    return *it;
+}
+
+void AudioPluginAudioProcessor::changeListenerCallback (juce::ChangeBroadcaster*)
+{
+    if (const int pending = pendingProgram.exchange (-1); pending >= 0)
+        setCurrentProgram (pending);
+
+    auto presets = presetLibrary->getPresets();
+    {
+        std::scoped_lock lock (currentPresetMutex);
+        auto it = std::find_if (presets->begin(), presets->end(), [this] (const Preset& p) { return p.file == currentPresetFile; });
+        if (it != presets->end())
+            currentProgram.store (static_cast<int> (std::distance (presets->begin(), it)));
+    }
+
+    updateHostDisplay (juce::AudioProcessor::ChangeDetails().withProgramChanged (true));
 }
 
 const juce::String AudioPluginAudioProcessor::getProgramName (int index)
 {
-    juce::ignoreUnused (index);
-    return {};
+    auto presets = presetLibrary->getPresets();
+    if (! juce::isPositiveAndBelow (index, static_cast<int> (presets->size())))
+        return {};
+
+    return (*presets)[static_cast<size_t> (index)].name;
 }
 
 void AudioPluginAudioProcessor::changeProgramName (int index, const juce::String& newName)
@@ -119,12 +311,105 @@ void AudioPluginAudioProcessor::changeProgramName (int index, const juce::String
     juce::ignoreUnused (index, newName);
 }
 
+void AudioPluginAudioProcessor::submitScript (std::string script, std::optional<std::string> packagePath, int slot)
+{
+    auto& target = *slots[static_cast<size_t> (juce::jlimit (0, NUM_SCRIPT_SLOTS - 1, slot))];
+
+    {
+        std::scoped_lock lock (target.compileMutex);
+        target.lastSubmittedScript = script;
+        target.compileString = std::move (script);
+        if (packagePath) {
+            target.lastSubmittedPackagePath = packagePath;
+            target.packagePath = std::move (packagePath);
+        }
+    }
+    scriptCompiler.compilePending();
+}
+
+void AudioPluginAudioProcessor::resubmitLastScript (int slot)
+{
+    auto& target = *slots[static_cast<size_t> (juce::jlimit (0, NUM_SCRIPT_SLOTS - 1, slot))];
+
+    {
+        std::scoped_lock lock (target.compileMutex);
+        if (! target.lastSubmittedScript || target.compileString)
+            return; // nothing compiled yet, or a newer script is about to be
+        target.compileString = target.lastSubmittedScript;
+        target.packagePath = target.lastSubmittedPackagePath;
+    }
+    scriptCompiler.compilePending();
+}
+
+void AudioPluginAudioProcessor::watchScriptFile (const juce::File& file, const juce::String& source)
+{
+    {
+        std::scoped_lock lock (watchMutex);
+        watchedScriptFile = file;
+    }
+    scriptFileWatcher.watch (file, source);
+}
+
+void AudioPluginAudioProcessor::unwatchScriptFile()
+{
+    {
+        std::scoped_lock lock (watchMutex);
+        watchedScriptFile = std::nullopt;
+    }
+    scriptFileWatcher.unwatch();
+}
+
+std::optional<juce::File> AudioPluginAudioProcessor::getWatchedScriptFile()
+{
+    std::scoped_lock lock (watchMutex);
+    return watchedScriptFile;
+}
+
+juce::String AudioPluginAudioProcessor::getReloadedSource()
+{
+    std::scoped_lock lock (watchMutex);
+    return reloadedSource;
+}
+
+std::optional<std::string> AudioPluginAudioProcessor::startRecording (const juce::File& file)
+{
+    if (auto err = scriptRecorder.start (file.getFullPathName().toStdString()))
+        return err;
+
+    // The running scripts are recorded as they are instead of compiled again, so starting
+    // a recording keeps their globals and does not make the outputs jump
+    for (auto& slot : slots)
+        slot->recordRunningScript = true;
+
+    return std::nullopt;
+}
+
+void AudioPluginAudioProcessor::stopRecording()
+{
+    scriptRecorder.stop();
+}
+
 //==============================================================================
 void AudioPluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
-    juce::ignoreUnused (sampleRate, samplesPerBlock);
+    slotJobs.waitUntilIdle(); // a slot that missed the last deadline may still be evaluating
+    currentSampleRate = sampleRate;
+    processedSamples = 0;
+    for (auto& slot : slots) {
+        for (auto& results : slot->results)
+            results.resize (static_cast<size_t> (samplesPerBlock));
+        for (auto& encoder : slot->midiOutputEncoders)
+            encoder.reset();
+        for (auto& chain : slot->outputChains)
+            chain.prepare (sampleRate);
+        slot->messages.clear();
+    }
+
+    forwardedMessage.str.reserve (SlotMessages::MAX_LENGTH);
+
+    for (auto& analyser : inputAnalysers)
+        analyser.prepare (sampleRate);
+    inputFeatures = {};
 }
 
 void AudioPluginAudioProcessor::releaseResources()
@@ -160,8 +445,6 @@ bool AudioPluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
 void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
                                               juce::MidiBuffer& midiMessages)
 {
-    juce::ignoreUnused (midiMessages);
-
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -183,56 +466,284 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     // Alternatively, you can process the samples with the channels
     // interleaved by keeping the same state.
 
-    {
-        std::scoped_lock lock(luaEnvCompileMutex);
-        if (luaEnvCompileString) {
-            auto startTime = juce::Time::getHighResolutionTicks();
-            auto err = luaEnv.compile(luaEnvCompileString->c_str());
-            if (err)
-                luaOutputLog.add({*err, OutputLogMessageType::Error});
-            luaEnvCompileString = std::nullopt;
-            auto endTime = juce::Time::getHighResolutionTicks();
-            lastCompileTime.store((endTime - startTime)/double(juce::Time::getHighResolutionTicksPerSecond()));
-        }
+    auto startTime = juce::Time::getHighResolutionTicks();
+
+    const int numSamples = buffer.getNumSamples();
+
+    for (int channel = 0; channel < juce::jmin (totalNumInputChannels, MAX_ANALYSED_CHANNELS); channel++)
+        inputAnalysers[static_cast<size_t> (channel)].process (buffer.getReadPointer (channel), numSamples,
+                                                               inputFeatures[static_cast<size_t> (channel)]);
+
+    // Per frame evaluates each slot once for all channels
+    const bool perChannel = paramEvaluationMode->getIndex() == 1;
+    const int numEvaluatedChannels = perChannel ? juce::jlimit (1, ScriptSlot::MAX_OUTPUT_CHANNELS, totalNumInputChannels) : 1;
+    const double blockStartTime = static_cast<double> (processedSamples) / currentSampleRate;
+
+    // Slots still evaluating a previous block are left alone, run() does not schedule them
+    for (size_t s = 0; s < slots.size(); s++) {
+        if (! slotJobs.isIdle (static_cast<int> (s)))
+            continue;
+
+        auto& slot = *slots[s];
+        for (auto& results : slot.results)
+            if (results.size() < static_cast<size_t> (numSamples))
+                results.resize (static_cast<size_t> (numSamples));
+        slot.blockNumSamples = numSamples;
+        slot.blockNumChannels = numEvaluatedChannels;
+        slot.blockStartTime = blockStartTime;
+        slot.blockFeatures = inputFeatures; // a slot still evaluating keeps reading its own copy
     }
 
-    if (!luaEnv.hasInstance())
-        return;
+    // Waits for the slots at most for part of the block duration
+    workerPool->run (slotJobs, EVALUATION_TIMEOUT * numSamples / currentSampleRate);
 
-    auto startTime = juce::Time::getHighResolutionTicks();
+    const int outputMode = paramOutputMode->getIndex();
+
+    // Switching to MIDI, even back to the same mode, must send the current values whatever the threshold
+    if (outputMode != lastOutputMode) {
+        for (auto& slot : slots)
+            for (auto& encoder : slot->midiOutputEncoders)
+                encoder.reset();
+        lastOutputMode = outputMode;
+    }
+
+    // Every slot and output needs its own controller or channel, nothing is sent if they do not all fit
+    const auto midiMode = static_cast<MidiOutputEncoder::Mode> (juce::jmax (0, outputMode - 1));
+    const bool midiRangeFits = outputMode == 0
+                            || MidiOutputEncoder::getDestination (midiMode, paramMidiChannel->get(), paramMidiController->get(),
+                                                                  0, NUM_SCRIPT_SLOTS, 0, numEvaluatedChannels).has_value();
+    if (! midiRangeFits && ! midiRangeErrorLogged) {
+        static const OutputLogMessage rangeMessage { "MIDI Channel or MIDI Controller too high, every slot and channel needs its own, no MIDI is sent",
+                                                     OutputLogMessageType::Error };
+        luaOutputLog.add (rangeMessage);
+    }
+    midiRangeErrorLogged = ! midiRangeFits;
+    const int midiInterval = juce::roundToInt (paramMidiInterval->get() * 0.001 * currentSampleRate);
+
+    // Channel 1 of per channel evaluation is not a continuation of the per frame output
+    if (perChannel != lastPerChannel) {
+        for (auto& slot : slots)
+            for (auto& chain : slot->outputChains)
+                chain.reset();
+        lastPerChannel = perChannel;
+    }
+
+    OutputChainSettings outputChainSettings;
+    outputChainSettings.slewRate = paramSlewRate->get();
+    outputChainSettings.smoothing = static_cast<OutputChainSettings::Smoothing> (paramSmoothing->getIndex());
+    outputChainSettings.smoothingTime = paramSmoothingTime->get();
+    outputChainSettings.rangeMin = paramRangeMin->get();
+    outputChainSettings.rangeMax = paramRangeMax->get();
+    outputChainSettings.curve = paramCurve->get();
+
+    for (size_t s = 0; s < slots.size(); s++) {
+        // A slot that missed the deadline keeps its previous outputs for this block
+        if (! slotJobs.isFinished (static_cast<int> (s)))
+            continue;
+
+        auto& slot = *slots[s];
+        const bool recordRunning = slot.recordRunningScript.exchange (false);
+
+        if (slot.newlyCompiled) {
+            const auto& compiled = *slot.compiled;
+            // Through the same reserved string as slot messages, so forwarding does not allocate
+            for (const auto& message : compiled.messages) {
+                forwardedMessage.str.assign (message.str, 0, SlotMessages::MAX_LENGTH);
+                forwardedMessage.type = message.type;
+                luaOutputLog.add (forwardedMessage);
+            }
+            lastCompileTime.store (compiled.compileTime);
+            scriptRecorder.recordCompile (static_cast<int> (s), blockIndex, compiled.compileTime, compiled.failed,
+                                          compiled.script, compiled.packagePath);
+            slot.newlyCompiled = false;
+
+            // The new script starts from its own first value instead of ramping from the old one
+            for (auto& chain : slot.outputChains)
+                chain.reset();
+        }
+        else if (recordRunning && slot.compiled != nullptr) {
+            // The replay compiles this script into a fresh state and continues from there
+            const auto& compiled = *slot.compiled;
+            scriptRecorder.recordCompile (static_cast<int> (s), blockIndex, compiled.compileTime, compiled.failed,
+                                          compiled.script, compiled.packagePath);
+        }
+
+        // Copied through a string with reserved capacity as well
+        for (const auto& message : slot.messages) {
+            forwardedMessage.str.assign (message.getText());
+            forwardedMessage.type = message.type;
+            luaOutputLog.add (forwardedMessage);
+        }
+        if (slot.messages.dropped > 0) {
+            static const OutputLogMessage droppedMessage { "Too many messages in one block, some were dropped", OutputLogMessageType::Error };
+            luaOutputLog.add (droppedMessage);
+        }
+        slot.messages.clear();
+
+        if (! slot.active) {
+            for (auto& chain : slot.outputChains)
+                chain.reset();
+            continue;
+        }
 
-    /// TODO: do midi output? (probably not, keep parameter output)
-    /// TODO: optimization
-    for (int channel = 0; channel < totalNumInputChannels; channel++) {
-        auto* channelData = buffer.getWritePointer (channel);
-        juce::ignoreUnused (channelData);
-        // ..do something to the data...
-        for (int i = 0; i < buffer.getNumSamples(); i++) {
+        if (scriptRecorder.isRecording()) {
+            const double* outputs[ScriptSlot::MAX_OUTPUT_CHANNELS];
+            for (int c = 0; c < slot.numResultChannels; c++)
+                outputs[c] = slot.results[static_cast<size_t> (c)].data();
+            scriptRecorder.recordBlock (static_cast<int> (s), blockIndex, currentSampleRate, blockStartTime, slot.evaluationTime,
+                                        slot.blockFeatures.data(), ScriptSlot::MAX_FEATURE_CHANNELS, outputs, slot.numResultChannels, numSamples);
+        }
 
-            outputMonitorSampleCounter++;
+        for (int c = 0; c < slot.numResultChannels; c++) {
+            auto& results = slot.results[static_cast<size_t> (c)];
+
+            // After recording, so recordings hold what the script returned
+            slot.outputChains[static_cast<size_t> (c)].process (results.data(), numSamples, outputChainSettings);
+
+            // MIDI output is sample accurate and only sends changed values, at most one per MIDI
+            // Interval. Each slot gets its own controller, or its own channel for pitch bend.
+            // Evaluated channels are sent on consecutive MIDI channels.
+            if (outputMode > 0 && midiRangeFits) {
+                const auto destination = MidiOutputEncoder::getDestination (midiMode, paramMidiChannel->get(), paramMidiController->get(),
+                                                                            static_cast<int> (s), NUM_SCRIPT_SLOTS, c, numEvaluatedChannels);
+                auto addMessage = [&midiMessages] (const juce::uint8* bytes, int size, int sampleOffset) {
+                    midiMessages.addEvent (bytes, size, sampleOffset);
+                };
+                if (destination)
+                    slot.midiOutputEncoders[static_cast<size_t> (c)].process (results.data(), numSamples, addMessage, midiMode,
+                                                                              destination->channel, destination->controller,
+                                                                              paramMidiThreshold->get(), midiInterval);
+            }
 
-            auto result = luaEnv.runInstance();
-            if (result.error) {
-                luaOutputLog.add({*result.error, OutputLogMessageType::Error});
-                paramOutput->setValueNotifyingHost(0.0f);
+            auto* paramOutput = slot.paramOutputs[static_cast<size_t> (c)];
+            for (int i = 0; i < numSamples; i++) {
+                // Already in [-1, 1] and finite
+                auto value = static_cast<float>(results[static_cast<size_t> (i)]);
+                if (outputMode == 0 && ! juce::exactlyEqual (value, paramOutput->get()))
+                    paramOutput->setValueNotifyingHost(paramOutput->convertTo0to1(value));
+
+                if (s != 0 || c != 0)
+                    continue;
+
+                outputMonitorSampleCounter++;
                 if (outputMonitorSampleCounter >= 1200) {
-                    outputMonitor.add(0.0f);
+                    outputMonitor.add(value);
                     outputMonitorSampleCounter = 0;
                 }
-                continue;
-            }
-
-            auto clamped = juce::jlimit(-1.0f, 1.0f, static_cast<float>(result.result));
-            paramOutput->setValueNotifyingHost(clamped);
-            if (outputMonitorSampleCounter >= 1200) {
-                outputMonitor.add(clamped);
-                outputMonitorSampleCounter = 0;
             }
         }
     }
 
+    processedSamples += numSamples;
+
     auto endTime = juce::Time::getHighResolutionTicks();
     lastProcessBlockTime.store((endTime - startTime)/double(juce::Time::getHighResolutionTicksPerSecond()));
+    scriptRecorder.recordProcessBlock (blockIndex, lastProcessBlockTime.load());
+    blockIndex++;
+}
+
+void AudioPluginAudioProcessor::compileSlot (int index)
+{
+    auto& slot = *slots[static_cast<size_t> (index)];
+
+    // States replaced on the audio thread are closed here
+    delete slot.retiredCompile.exchange (nullptr, std::memory_order_acq_rel);
+
+    std::optional<std::string> compileString, packagePath;
+    {
+        std::scoped_lock lock (slot.compileMutex);
+        compileString.swap (slot.compileString);
+        packagePath.swap (slot.packagePath);
+    }
+
+    if (packagePath)
+        slot.packagePathInUse = std::move (packagePath);
+    if (! compileString)
+        return;
+
+    auto startTime = juce::Time::getHighResolutionTicks();
+
+    auto compiled = std::make_unique<CompiledScript>();
+    auto* compiledPtr = compiled.get();
+    compiled->script = std::move (*compileString);
+    compiled->packagePath = slot.packagePathInUse;
+
+    // Every compile starts from a fresh state, globals of the previous script do not carry over
+    compiled->luaEnv = luaEnvPool->acquire (LuaEnvLibraries::Sandboxed);
+    auto& luaEnv = *compiled->luaEnv;
+    compiled->messages.push_back ({ "Lua state: " + std::to_string (luaEnv.getCreationMemoryUsage() / 1024) + " kB, created in "
+                                        + juce::String (luaEnv.getCreationTime() * 1000.0, 2).toStdString() + " ms",
+                                    OutputLogMessageType::Text });
+    luaEnv.print_callback = [compiledPtr] (std::string s) {
+        if (compiledPtr->messages.size() < LUAENV_OUTPUTLOG_MAX_MESSAGES)
+            compiledPtr->messages.push_back ({s, OutputLogMessageType::Text});
+    };
+    compiled->timeVariable = luaEnv.registerVariable ("t");
+    compiled->channelVariable = luaEnv.registerVariable ("ch");
+    if (auto err = luaEnv.bindStruct ("input", AUDIO_FEATURES_CDEF, "AudioFeatures",
+                                      slot.blockFeatures.data(), slot.blockFeatures.size()))
+        compiled->messages.push_back ({*err, OutputLogMessageType::Error});
+
+    // Scripts only compute values, they get no file, process or native library access
+    if (auto err = luaEnv.sandbox())
+        compiled->messages.push_back ({*err, OutputLogMessageType::Error});
+
+    if (compiled->packagePath)
+        if (auto err = luaEnv.setPackagePath (*compiled->packagePath))
+            compiled->messages.push_back ({*err, OutputLogMessageType::Error});
+
+    auto err = luaEnv.compile (compiled->script.c_str());
+    if (! err)
+        err = luaEnv.preloadModules (compiled->script.c_str()); // so the first run does no file I/O
+    if (err)
+        compiled->messages.push_back ({*err, OutputLogMessageType::Error});
+    compiled->failed = ! luaEnv.hasInstance();
+
+    auto endTime = juce::Time::getHighResolutionTicks();
+    compiled->compileTime = (endTime - startTime) / double (juce::Time::getHighResolutionTicksPerSecond());
+
+    // Slots may run on worker threads, messages are forwarded to luaOutputLog after evaluation
+    auto* slotPtr = &slot;
+    luaEnv.print_callback = [slotPtr] (std::string s) {
+        slotPtr->messages.add (s, OutputLogMessageType::Text);
+    };
+
+    // Replaces a script compiled earlier that was not picked up yet
+    delete slot.pendingCompile.exchange (compiled.release(), std::memory_order_acq_rel);
+}
+
+void AudioPluginAudioProcessor::evaluateSlot (int index)
+{
+    auto& slot = *slots[static_cast<size_t> (index)];
+
+    // Swapping pointers is all that happens here, the replaced state is closed by compileSlot
+    if (slot.retiredCompile.load (std::memory_order_acquire) == nullptr) {
+        if (auto* next = slot.pendingCompile.exchange (nullptr, std::memory_order_acq_rel)) {
+            slot.retiredCompile.store (slot.compiled.release(), std::memory_order_release);
+            slot.compiled.reset (next);
+            slot.newlyCompiled = true;
+        }
+    }
+
+    slot.active = slot.compiled != nullptr && slot.compiled->luaEnv->hasInstance();
+    if (! slot.active)
+        return;
+
+    auto& compiled = *slot.compiled;
+    auto startTime = juce::Time::getHighResolutionTicks();
+
+    slot.numResultChannels = slot.blockNumChannels;
+    for (int channel = 0; channel < slot.blockNumChannels; channel++) {
+        // Every channel sees the same time values
+        compiled.luaEnv->setVariable (compiled.timeVariable, slot.blockStartTime, 1.0 / currentSampleRate);
+        compiled.luaEnv->setVariable (compiled.channelVariable, channel);
+
+        if (auto err = compiled.luaEnv->runBlock (slot.results[static_cast<size_t> (channel)].data(), slot.blockNumSamples))
+            slot.messages.add (*err, OutputLogMessageType::Error);
+    }
+
+    auto endTime = juce::Time::getHighResolutionTicks();
+    slot.evaluationTime = (endTime - startTime) / double (juce::Time::getHighResolutionTicksPerSecond());
 }
 
 //==============================================================================
@@ -3,10 +3,19 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 
 #include "LuaEnv.h"
+#include "LuaEnvPool.h"
 #include "CircularBuffer.h"
+#include "AudioAnalyser.h"
+#include "PresetLibrary.h"
+#include "ScriptCompiler.h"
+#include "ScriptFileWatcher.h"
+#include "ScriptSlot.h"
+#include "ScriptWorkerPool.h"
+#include "ScriptRecorder.h"
 
 //==============================================================================
-class AudioPluginAudioProcessor final : public juce::AudioProcessor
+class AudioPluginAudioProcessor final : public juce::AudioProcessor,
+                                        private juce::ChangeListener
 {
 public:
     //==============================================================================
@@ -45,10 +54,15 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    LuaEnv luaEnv;
+    constexpr static int NUM_SCRIPT_SLOTS = 4;
+    std::array<std::unique_ptr<ScriptSlot>, NUM_SCRIPT_SLOTS> slots;
+    juce::SharedResourcePointer<ScriptWorkerPool> workerPool; // evaluates slots in parallel, shared by every instance
+
+    /// Fraction of the block duration processBlock waits for slots to finish evaluating
+    constexpr static double EVALUATION_TIMEOUT = 0.5;
 
     constexpr static size_t OUTPUT_MONITOR_BUFFER_SIZE = 400;
-    CircularBuffer<float, OUTPUT_MONITOR_BUFFER_SIZE> outputMonitor;
+    CircularBuffer<float, OUTPUT_MONITOR_BUFFER_SIZE> outputMonitor; // first slot only
     size_t outputMonitorSampleCounter = 0;
 
     CircularBuffer<OutputLogMessage, LUAENV_OUTPUTLOG_MAX_MESSAGES> luaOutputLog;
@@ -56,14 +70,89 @@ public:
     std::atomic<double> lastCompileTime{0};
     std::atomic<double> lastProcessBlockTime{0};
 
-    std::mutex luaEnvCompileMutex;
-    std::optional<std::string> luaEnvCompileString;
-
-    /// TODO: Rename to paramOutputValue, or luaParamOutputValue, etc. idk yet
-    juce::AudioParameterFloat* paramOutput;
+    /// Queues a script to be compiled for `slot` on the compiler thread, it replaces the running
+    /// script at the start of a later processBlock. `packagePath` is the directory require()
+    /// searches for modules, kept until changed.
+    void submitScript(std::string script, std::optional<std::string> packagePath = std::nullopt, int slot = 0);
+
+    /// Hot reloads `file` into hotReloadSlot when it or its modules change on disk. The watcher
+    /// belongs to the processor, so reloading keeps working while the editor is closed.
+    void watchScriptFile (const juce::File& file, const juce::String& source);
+    void unwatchScriptFile();
+    std::optional<juce::File> getWatchedScriptFile();
+    std::atomic<int> hotReloadSlot{0};
+
+    /// Sends a change message when hot reload found the watched script itself changed
+    juce::ChangeBroadcaster scriptReloaded;
+    juce::String getReloadedSource();
+
+    ScriptRecorder scriptRecorder; // opt-in, started from the editor
+
+    /// Starts recording into `file`. The running scripts are recorded without compiling
+    /// them again, their live state is kept but is not part of the recording.
+    std::optional<std::string> startRecording(const juce::File& file);
+    void stopRecording();
+
+    juce::SharedResourcePointer<PresetLibrary> presetLibrary; // one index for every instance
+    std::atomic<int> currentProgram{0};
+
+    /// Loads the preset at `file` if it is in the current index, and returns it
+    std::optional<Preset> loadPreset (const juce::File& file);
+
+    double currentSampleRate = 44100.0;
+    juce::int64 processedSamples = 0;
+
+    // Features of the main input bus, copied to every slot that starts evaluating a block
+    constexpr static int MAX_ANALYSED_CHANNELS = ScriptSlot::MAX_FEATURE_CHANNELS;
+    std::array<AudioAnalyser, MAX_ANALYSED_CHANNELS> inputAnalysers;
+    std::array<AudioFeatures, MAX_ANALYSED_CHANNELS> inputFeatures{};
+
+    // "Per Frame" evaluates every slot once per sample frame, "Per Channel" once per channel with `ch` set
+    juce::AudioParameterChoice* paramEvaluationMode;
+    // "Parameter" writes each slot's output parameters, the other choices map to MidiOutputEncoder::Mode
+    juce::AudioParameterChoice* paramOutputMode;
+    juce::AudioParameterInt* paramMidiChannel;
+    juce::AudioParameterInt* paramMidiController;
+    juce::AudioParameterInt* paramMidiThreshold;
+    juce::AudioParameterFloat* paramMidiInterval; // ms between messages of one output
+    // Settings of every slot's OutputChain
+    juce::AudioParameterFloat* paramSlewRate;
+    juce::AudioParameterChoice* paramSmoothing;
+    juce::AudioParameterFloat* paramSmoothingTime;
+    juce::AudioParameterFloat* paramRangeMin;
+    juce::AudioParameterFloat* paramRangeMax;
+    juce::AudioParameterFloat* paramCurve;
  
     juce::AudioProcessorValueTreeState valueTreeState;
 private:
+    juce::uint64 blockIndex = 0;
+    int lastOutputMode = 0; // resets the MIDI encoders when it changes
+    bool midiRangeErrorLogged = false; // logged once until the MIDI destinations fit again
+    bool lastPerChannel = false; // resets the output chains when the evaluation mode changes
+    OutputLogMessage forwardedMessage { {}, OutputLogMessageType::Text }; // reused when forwarding slot messages to luaOutputLog
+
+    // Compiles the last script submitted to `slot` again, unless another one is pending
+    void resubmitLastScript (int slot);
+    void compileSlot(int index);
+    void evaluateSlot(int index);
+    ScriptWorkerPool::JobSet slotJobs { NUM_SCRIPT_SLOTS, [this] (int index) { evaluateSlot (index); } };
+
+    // Keeps currentProgram pointing at the loaded preset when the index changes
+    void changeListenerCallback (juce::ChangeBroadcaster*) override;
+    std::mutex currentPresetMutex;
+    juce::File currentPresetFile;
+    std::atomic<int> pendingProgram{-1}; // set before the first preset scan finished
+
+    juce::SharedResourcePointer<LuaEnvPool> luaEnvPool; // outlives the compiler taking states from it
+    ScriptCompiler scriptCompiler { NUM_SCRIPT_SLOTS, [this] (int index) { compileSlot (index); } };
+
+    std::mutex watchMutex;
+    std::optional<juce::File> watchedScriptFile;
+    juce::String reloadedSource;
+
+    // Declared last, so it stops before anything it reloads into
+    ScriptFileWatcher scriptFileWatcher;
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessor)
 };
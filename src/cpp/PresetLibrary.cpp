@@ -0,0 +1,102 @@
+#include "PresetLibrary.h"
+#include "LuaBytecodeCache.h"
+
+#include <algorithm>
+
+PresetLibrary::PresetLibrary()
+    : juce::Thread("Preset Library"),
+      searchDirectories({
+          juce::File(SOURCE_DIR).getChildFile("presets"),
+          juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("Formulizer Controller/Presets")
+      }),
+      presets(std::make_shared<const std::vector<Preset>>())
+{
+    startThread(juce::Thread::Priority::background);
+}
+
+PresetLibrary::~PresetLibrary() {
+    stopThread(RESCAN_INTERVAL_MS);
+}
+
+std::shared_ptr<const std::vector<Preset>> PresetLibrary::getPresets() const {
+    std::scoped_lock lock(mutex);
+    return presets;
+}
+
+void PresetLibrary::run() {
+    while (!threadShouldExit()) {
+        scan();
+        scanned = true;
+        wait(RESCAN_INTERVAL_MS);
+    }
+}
+
+void PresetLibrary::scan() {
+    auto previous = getPresets();
+    auto updated = std::make_shared<std::vector<Preset>>();
+    bool changed = false;
+
+    for (const auto& directory : searchDirectories) {
+        for (const auto& file : directory.findChildFiles(juce::File::findFiles, true, "*.lua")) {
+            if (threadShouldExit())
+                return;
+
+            auto it = std::find_if(previous->begin(), previous->end(),
+                                   [&file](const Preset& p) { return p.file == file; });
+
+            // Unchanged files are not read again
+            if (it != previous->end() && it->modificationTime == file.getLastModificationTime()) {
+                updated->push_back(*it);
+                continue;
+            }
+
+            updated->push_back(readPreset(file));
+            changed = true;
+        }
+    }
+
+    if (!changed && updated->size() == previous->size())
+        return;
+
+    std::sort(updated->begin(), updated->end(),
+              [](const Preset& a, const Preset& b) { return a.name.compareNatural(b.name) < 0; });
+
+    {
+        std::scoped_lock lock(mutex);
+        presets = std::move(updated);
+    }
+
+    sendChangeMessage();
+}
+
+Preset PresetLibrary::readPreset(const juce::File& file) {
+    Preset preset;
+    preset.file = file;
+    preset.name = file.getFileNameWithoutExtension();
+    preset.modificationTime = file.getLastModificationTime();
+
+    juce::String source = file.loadFileAsString();
+    preset.source = source.toStdString();
+    preset.hash = source.hashCode64();
+
+    for (const auto& line : juce::StringArray::fromLines(source)) {
+        auto trimmed = line.trim();
+        if (trimmed.isEmpty())
+            continue;
+        if (!trimmed.startsWith("--"))
+            break; // metadata only lives in the leading comment block
+
+        auto comment = trimmed.substring(2).trim();
+        if (comment.startsWith("@name:"))
+            preset.name = comment.fromFirstOccurrenceOf(":", false, false).trim();
+        else if (comment.startsWith("@tags:"))
+            preset.tags.addTokens(comment.fromFirstOccurrenceOf(":", false, false), ",", "");
+    }
+    preset.tags.trim();
+    preset.tags.removeEmptyStrings();
+
+    // Syntax errors are reported when the preset is compiled by the processor
+    LuaBytecodeCache::getInstance().precompile(preset.source);
+
+    return preset;
+}
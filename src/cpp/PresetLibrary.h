@@ -0,0 +1,58 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct Preset {
+    juce::String name;
+    juce::File file;
+    juce::StringArray tags;
+    juce::Time modificationTime;
+    juce::int64 hash;
+    std::string source;
+};
+
+/// Index of the `.lua` presets found in the preset directories, shared by every plugin
+/// instance through juce::SharedResourcePointer. Scans run on a background thread, the first
+/// one straight after construction so instantiating the plugin does not wait for the disk.
+/// Every change, including the result of the first scan, is broadcast as a change message.
+/// Every preset is precompiled into the LuaBytecodeCache, so switching presets needs neither
+/// disk access nor parsing.
+///
+/// Presets may declare metadata in comment lines:
+///     -- @name: Basic LFO
+///     -- @tags: lfo, basic
+class PresetLibrary : public juce::ChangeBroadcaster,
+                      private juce::Thread {
+public:
+    PresetLibrary();
+    ~PresetLibrary() override;
+
+    PresetLibrary(const PresetLibrary&) = delete;
+    PresetLibrary& operator=(const PresetLibrary&) = delete;
+
+    /// Snapshot of the index, sorted by name. Never blocks on a scan.
+    std::shared_ptr<const std::vector<Preset>> getPresets() const;
+
+    /// False until the first scan finished, the index is empty before
+    bool hasScanned() const { return scanned.load(); }
+
+    static constexpr int RESCAN_INTERVAL_MS = 2000;
+
+private:
+    void run() override;
+    void scan();
+
+    static Preset readPreset(const juce::File& file);
+
+    mutable std::mutex mutex;
+    const juce::Array<juce::File> searchDirectories;
+    std::shared_ptr<const std::vector<Preset>> presets;
+    std::atomic<bool> scanned{false};
+};
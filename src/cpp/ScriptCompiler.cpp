@@ -0,0 +1,28 @@
+#include "ScriptCompiler.h"
+
+ScriptCompiler::ScriptCompiler(int slots, std::function<void(int)> jobToRun)
+    : juce::Thread("Script Compiler"),
+      numSlots(slots),
+      job(std::move(jobToRun))
+{
+}
+
+ScriptCompiler::~ScriptCompiler() {
+    stopThread(1000);
+}
+
+void ScriptCompiler::start() {
+    startThread(juce::Thread::Priority::normal);
+}
+
+void ScriptCompiler::compilePending() {
+    notify();
+}
+
+void ScriptCompiler::run() {
+    while (!threadShouldExit()) {
+        for (int i = 0; i < numSlots && !threadShouldExit(); i++)
+            job(i);
+        wait(POLL_INTERVAL_MS);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <functional>
+
+/// Background thread compiling submitted scripts, so the audio thread never parses, touches the
+/// filesystem or closes a lua_State. `job` is called with every slot index after compilePending()
+/// and every POLL_INTERVAL_MS: it compiles a pending script into a new LuaEnv and frees the
+/// states the audio thread replaced.
+class ScriptCompiler : private juce::Thread {
+public:
+    ScriptCompiler(int numSlots, std::function<void(int)> job);
+    ~ScriptCompiler() override;
+
+    ScriptCompiler(const ScriptCompiler&) = delete;
+    ScriptCompiler& operator=(const ScriptCompiler&) = delete;
+
+    /// Starts the thread, once everything the job uses exists
+    void start();
+
+    /// Runs the job for every slot as soon as possible
+    void compilePending();
+
+    static constexpr int POLL_INTERVAL_MS = 50;
+
+private:
+    void run() override;
+
+    const int numSlots;
+    const std::function<void(int)> job;
+};
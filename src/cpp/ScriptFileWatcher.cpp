@@ -0,0 +1,117 @@
+#include "ScriptFileWatcher.h"
+#include "LuaBytecodeCache.h"
+#include "LuaEnv.h"
+
+#include <algorithm>
+
+ScriptFileWatcher::ScriptFileWatcher()
+    : juce::Thread("Script File Watcher")
+{
+}
+
+ScriptFileWatcher::~ScriptFileWatcher() {
+    stopThread(1000);
+}
+
+void ScriptFileWatcher::watch(const juce::File& file, const juce::String& knownSource) {
+    {
+        std::scoped_lock lock(mutex);
+        pendingWatch = std::make_pair(file, knownSource);
+        pendingUnwatch = false;
+    }
+
+    if (!isThreadRunning())
+        startThread(juce::Thread::Priority::low);
+}
+
+void ScriptFileWatcher::unwatch() {
+    std::scoped_lock lock(mutex);
+    pendingWatch = std::nullopt;
+    pendingUnwatch = true;
+}
+
+void ScriptFileWatcher::run() {
+    while (!threadShouldExit()) {
+        std::optional<std::pair<juce::File, juce::String>> request;
+        {
+            std::scoped_lock lock(mutex);
+            if (pendingUnwatch) {
+                watched.clear();
+                lastChangeTime = std::nullopt;
+                pendingUnwatch = false;
+            }
+            request.swap(pendingWatch);
+        }
+
+        if (request) {
+            const auto& [file, source] = *request;
+            watched = { { file, file.getLastModificationTime(), source.hashCode64() } };
+            collectDependencies(source, file.getParentDirectory());
+            lastChangeTime = std::nullopt;
+        }
+
+        // Polling modification times is cheap and works the same on every platform
+        for (auto& w : watched) {
+            auto modificationTime = w.file.getLastModificationTime();
+            if (modificationTime != w.modificationTime) {
+                w.modificationTime = modificationTime;
+                lastChangeTime = juce::Time::getMillisecondCounter();
+            }
+        }
+
+        // Editors often write files in several steps, wait until they settle
+        if (lastChangeTime && juce::Time::getMillisecondCounter() - *lastChangeTime >= DEBOUNCE_MS) {
+            lastChangeTime = std::nullopt;
+            reload();
+        }
+
+        wait(POLL_INTERVAL_MS);
+    }
+}
+
+void ScriptFileWatcher::reload() {
+    if (watched.empty() || !watched[0].file.existsAsFile())
+        return;
+
+    const juce::File file = watched[0].file;
+    const juce::String source = file.loadFileAsString();
+
+    bool scriptChanged = source.hashCode64() != watched[0].hash;
+    bool modulesChanged = false;
+    for (size_t i = 1; i < watched.size(); i++)
+        if (watched[i].file.loadFileAsString().hashCode64() != watched[i].hash)
+            modulesChanged = true;
+
+    if (!scriptChanged && !modulesChanged)
+        return; // e.g. saved from the plugin editor itself
+
+    // The script's requires may have changed too
+    watched.resize(1);
+    watched[0].hash = source.hashCode64();
+    collectDependencies(source, file.getParentDirectory());
+
+    // Compile here so the processor only has to load bytecode
+    LuaBytecodeCache::getInstance().precompile(source.toStdString());
+    for (size_t i = 1; i < watched.size(); i++)
+        LuaBytecodeCache::getInstance().precompileFile(watched[i].file.getFullPathName().toStdString());
+
+    if (onReload)
+        onReload(file, source, scriptChanged);
+}
+
+void ScriptFileWatcher::collectDependencies(const juce::String& source, const juce::File& directory) {
+    for (const auto& name : LuaEnv::findRequires(source.toStdString())) {
+        auto moduleFile = directory.getChildFile(juce::String(name).replaceCharacter('.', '/') + ".lua");
+        if (!moduleFile.existsAsFile())
+            continue;
+
+        bool alreadyWatched = std::any_of(watched.begin(), watched.end(),
+                                          [&moduleFile](const WatchedFile& w) { return w.file == moduleFile; });
+        if (alreadyWatched)
+            continue;
+
+        auto moduleSource = moduleFile.loadFileAsString();
+        watched.push_back({ moduleFile, moduleFile.getLastModificationTime(), moduleSource.hashCode64() });
+        collectDependencies(moduleSource, directory);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/// Watches a script file and the modules it require()s, resolved relative to the script's
+/// directory. Changes are debounced, the new source is precompiled into the LuaBytecodeCache
+/// and onReload is called, all on a background thread.
+class ScriptFileWatcher : private juce::Thread {
+public:
+    ScriptFileWatcher();
+    ~ScriptFileWatcher() override;
+
+    ScriptFileWatcher(const ScriptFileWatcher&) = delete;
+    ScriptFileWatcher& operator=(const ScriptFileWatcher&) = delete;
+
+    /// `knownSource` is the content the caller already has, so it is not reported as a change
+    void watch(const juce::File& file, const juce::String& knownSource);
+
+    void unwatch();
+
+    /// Called from the background thread with the script source after the script or one of its
+    /// modules changed. `scriptChanged` is false if only modules changed.
+    std::function<void(const juce::File& file, const juce::String& source, bool scriptChanged)> onReload;
+
+    static constexpr int POLL_INTERVAL_MS = 20;
+    static constexpr int DEBOUNCE_MS = 100;
+
+private:
+    struct WatchedFile {
+        juce::File file;
+        juce::Time modificationTime;
+        juce::int64 hash;
+    };
+
+    void run() override;
+    void reload();
+    void collectDependencies(const juce::String& source, const juce::File& directory);
+
+    std::mutex mutex;
+    std::optional<std::pair<juce::File, juce::String>> pendingWatch;
+    bool pendingUnwatch = false;
+
+    // Only used by the background thread
+    std::vector<WatchedFile> watched; // script first, then its modules
+    std::optional<juce::uint32> lastChangeTime;
+};
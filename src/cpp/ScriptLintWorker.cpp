@@ -0,0 +1,54 @@
+#include "ScriptLintWorker.h"
+
+ScriptLintWorker::ScriptLintWorker(std::vector<std::string> globals)
+    : juce::Thread("Script Linter"),
+      hostGlobals(std::move(globals))
+{
+}
+
+ScriptLintWorker::~ScriptLintWorker() {
+    stopThread(1000);
+}
+
+void ScriptLintWorker::lint(std::string source, bool immediate) {
+    {
+        std::scoped_lock lock(mutex);
+        pendingSource = std::move(source);
+        pendingImmediate = pendingImmediate || immediate;
+    }
+
+    if (!isThreadRunning())
+        startThread(juce::Thread::Priority::low);
+    else
+        notify();
+}
+
+void ScriptLintWorker::run() {
+    while (!threadShouldExit()) {
+        bool immediate;
+        {
+            std::scoped_lock lock(mutex);
+            immediate = pendingImmediate;
+        }
+
+        // Every new request while waiting restarts the debounce
+        if (!immediate && wait(DEBOUNCE_MS))
+            continue;
+
+        std::optional<std::string> source;
+        {
+            std::scoped_lock lock(mutex);
+            source.swap(pendingSource);
+            pendingImmediate = false;
+        }
+
+        if (!source) {
+            wait(-1);
+            continue;
+        }
+
+        auto warnings = ScriptLinter::lint(*source, hostGlobals);
+        if (onResult && !threadShouldExit())
+            onResult(warnings);
+    }
+}
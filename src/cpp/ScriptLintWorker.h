@@ -0,0 +1,39 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ScriptLinter.h"
+
+/// Runs the ScriptLinter on a background thread. Requests made while typing are debounced,
+/// only the latest source is linted.
+class ScriptLintWorker : private juce::Thread {
+public:
+    explicit ScriptLintWorker(std::vector<std::string> hostGlobals);
+    ~ScriptLintWorker() override;
+
+    ScriptLintWorker(const ScriptLintWorker&) = delete;
+    ScriptLintWorker& operator=(const ScriptLintWorker&) = delete;
+
+    /// `immediate` skips the debounce, e.g. when the script is about to be compiled
+    void lint(std::string source, bool immediate = false);
+
+    /// Called from the background thread with the warnings for the latest source
+    std::function<void(const std::vector<LintWarning>& warnings)> onResult;
+
+    static constexpr int DEBOUNCE_MS = 300;
+
+private:
+    void run() override;
+
+    const std::vector<std::string> hostGlobals;
+
+    std::mutex mutex;
+    std::optional<std::string> pendingSource;
+    bool pendingImmediate = false;
+};
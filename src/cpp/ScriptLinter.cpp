@@ -0,0 +1,375 @@
+#include "ScriptLinter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <tuple>
+
+namespace {
+
+struct Token {
+    enum class Type {
+        Name,
+        Number,
+        String,
+        Op
+    };
+
+    Type type;
+    std::string text;
+    int line;
+    int column;
+};
+
+bool isNameStart(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isNameChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+class Lexer {
+public:
+    explicit Lexer(const std::string& source) : src(source) {}
+
+    std::vector<Token> tokenize() {
+        std::vector<Token> tokens;
+
+        while (pos < src.size()) {
+            const char c = src[pos];
+
+            if (c == '\n') {
+                newline();
+                continue;
+            }
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                pos++;
+                continue;
+            }
+
+            const int tokenLine = line;
+            const int tokenColumn = column();
+
+            if (c == '-' && peek(1) == '-') {
+                pos += 2;
+                int level = longBracketLevel();
+                if (level >= 0)
+                    skipLongBracket(level);
+                else
+                    while (pos < src.size() && src[pos] != '\n')
+                        pos++;
+                continue;
+            }
+
+            if (c == '[' && longBracketLevel() >= 0) {
+                skipLongBracket(longBracketLevel());
+                tokens.push_back({Token::Type::String, "", tokenLine, tokenColumn});
+                continue;
+            }
+
+            if (c == '"' || c == '\'') {
+                skipQuotedString(c);
+                tokens.push_back({Token::Type::String, "", tokenLine, tokenColumn});
+                continue;
+            }
+
+            if (isNameStart(c)) {
+                size_t start = pos;
+                while (pos < src.size() && isNameChar(src[pos]))
+                    pos++;
+                tokens.push_back({Token::Type::Name, src.substr(start, pos - start), tokenLine, tokenColumn});
+                continue;
+            }
+
+            if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && std::isdigit(static_cast<unsigned char>(peek(1))))) {
+                size_t start = pos;
+                skipNumber();
+                tokens.push_back({Token::Type::Number, src.substr(start, pos - start), tokenLine, tokenColumn});
+                continue;
+            }
+
+            static const char* const longOps[] = {"...", "..", "==", "~=", "<=", ">=", "::"};
+            std::string op(1, c);
+            for (const char* longOp : longOps) {
+                if (src.compare(pos, std::char_traits<char>::length(longOp), longOp) == 0) {
+                    op = longOp;
+                    break;
+                }
+            }
+            pos += op.size();
+            tokens.push_back({Token::Type::Op, op, tokenLine, tokenColumn});
+        }
+
+        return tokens;
+    }
+
+private:
+    char peek(size_t offset) const {
+        return pos + offset < src.size() ? src[pos + offset] : '\0';
+    }
+
+    int column() const {
+        return static_cast<int>(pos - lineStart) + 1;
+    }
+
+    void newline() {
+        pos++;
+        line++;
+        lineStart = pos;
+    }
+
+    // Level of a `[==[` opening at pos, or -1 if there is none
+    int longBracketLevel() const {
+        if (peek(0) != '[')
+            return -1;
+        size_t i = 1;
+        while (peek(i) == '=')
+            i++;
+        return peek(i) == '[' ? static_cast<int>(i - 1) : -1;
+    }
+
+    void skipLongBracket(int level) {
+        pos += static_cast<size_t>(level) + 2;
+        const std::string close = "]" + std::string(static_cast<size_t>(level), '=') + "]";
+        while (pos < src.size()) {
+            if (src.compare(pos, close.size(), close) == 0) {
+                pos += close.size();
+                return;
+            }
+            if (src[pos] == '\n')
+                newline();
+            else
+                pos++;
+        }
+    }
+
+    void skipQuotedString(char quote) {
+        pos++;
+        while (pos < src.size() && src[pos] != quote) {
+            if (src[pos] == '\n')
+                return; // unfinished string
+            if (src[pos] == '\\' && peek(1) == '\n') {
+                pos++;
+                newline();
+                continue;
+            }
+            pos += src[pos] == '\\' ? 2 : 1;
+        }
+        pos++;
+    }
+
+    void skipNumber() {
+        const bool hex = peek(0) == '0' && (peek(1) == 'x' || peek(1) == 'X');
+        if (hex)
+            pos += 2;
+
+        while (pos < src.size()) {
+            const char c = src[pos];
+            const bool exponent = hex ? (c == 'p' || c == 'P') : (c == 'e' || c == 'E');
+            if (exponent && (peek(1) == '+' || peek(1) == '-'))
+                pos += 2;
+            else if (c == '.' && peek(1) != '.')
+                pos++;
+            else if (isNameChar(c)) // digits, hex digits and suffixes like ULL
+                pos++;
+            else
+                break;
+        }
+    }
+
+    const std::string& src;
+    size_t pos = 0;
+    size_t lineStart = 0;
+    int line = 1;
+};
+
+const std::set<std::string> keywords = {
+    "and", "break", "do", "else", "elseif", "end", "false", "for", "function", "goto", "if", "in",
+    "local", "nil", "not", "or", "repeat", "return", "then", "true", "until", "while"
+};
+
+const std::set<std::string> libraryGlobals = {
+    "_G", "_VERSION", "assert", "bit", "collectgarbage", "coroutine", "debug", "dofile", "error", "ffi",
+    "getfenv", "getmetatable", "io", "ipairs", "jit", "load", "loadfile", "loadstring", "math", "module",
+    "next", "os", "package", "pairs", "pcall", "print", "rawequal", "rawget", "rawlen", "rawset", "require",
+    "select", "setfenv", "setmetatable", "string", "table", "tonumber", "tostring", "type", "unpack", "xpcall"
+};
+
+// Functions that LuaJIT 2.1 does not compile, a trace calling them is aborted
+const std::set<std::string> notCompiledFunctions = {
+    "collectgarbage", "dofile", "getfenv", "load", "loadfile", "loadstring", "next", "pairs", "require",
+    "setfenv", "xpcall",
+    "string.dump", "string.gmatch", "string.gsub", "string.match",
+    "table.foreach", "table.foreachi", "table.sort"
+};
+
+// Libraries where no function is compiled
+const std::set<std::string> notCompiledLibraries = {"coroutine", "debug", "io", "os"};
+
+const std::set<std::string> patternMethods = {"gmatch", "gsub", "match"};
+
+} // namespace
+
+std::vector<LintWarning> ScriptLinter::lint(const std::string& source, const std::vector<std::string>& hostGlobals) {
+    const std::vector<Token> tokens = Lexer(source).tokenize();
+
+    std::vector<LintWarning> warnings;
+    auto warn = [&warnings](const Token& token, LintWarning::Severity severity, std::string message) {
+        const int length = token.text.empty() ? 1 : static_cast<int>(token.text.size());
+        warnings.push_back({token.line, token.column, length, severity, std::move(message)});
+    };
+
+    std::set<std::string> locals(hostGlobals.begin(), hostGlobals.end());
+    locals.insert("self");
+    std::set<std::string> reportedGlobals;
+
+    enum class Block {
+        Loop,
+        Other
+    };
+    std::vector<Block> blocks;
+    int pendingLoopDo = 0; // `while` and `for` whose `do` is still to come
+    std::vector<char> brackets;
+
+    auto isOp = [&tokens](size_t i, const char* op) {
+        return i < tokens.size() && tokens[i].type == Token::Type::Op && tokens[i].text == op;
+    };
+    auto isName = [&tokens](size_t i) {
+        return i < tokens.size() && tokens[i].type == Token::Type::Name && keywords.count(tokens[i].text) == 0;
+    };
+    auto declareNames = [&](size_t i, const char* stopOp) {
+        for (; i < tokens.size() && !isOp(i, stopOp); i++) {
+            if (isName(i))
+                locals.insert(tokens[i].text);
+            else if (!isOp(i, ","))
+                break;
+        }
+    };
+
+    for (size_t i = 0; i < tokens.size(); i++) {
+        const Token& token = tokens[i];
+        const bool inLoop = std::find(blocks.begin(), blocks.end(), Block::Loop) != blocks.end();
+
+        if (token.type == Token::Type::Op) {
+            if (token.text == "{") {
+                warn(token, LintWarning::Severity::Medium,
+                     "Table constructor allocates a new table on every sample, create it once or use plain numbers");
+                brackets.push_back('{');
+            } else if (token.text == "(" || token.text == "[") {
+                brackets.push_back(token.text[0]);
+            } else if ((token.text == "}" || token.text == ")" || token.text == "]") && !brackets.empty()) {
+                brackets.pop_back();
+            } else if (token.text == "..") {
+                warn(token, LintWarning::Severity::Medium,
+                     "String concatenation allocates a new string on every sample");
+            } else if (token.text == ":" && isName(i + 1) && isOp(i + 2, "(") && patternMethods.count(tokens[i + 1].text)) {
+                warn(tokens[i + 1], LintWarning::Severity::High,
+                     "string." + tokens[i + 1].text + " is not compiled by LuaJIT, the JIT falls back to the interpreter");
+            }
+            continue;
+        }
+
+        if (token.type != Token::Type::Name)
+            continue;
+
+        if (token.text == "local") {
+            if (i + 1 < tokens.size() && tokens[i + 1].text == "function")
+                declareNames(i + 2, "(");
+            else
+                declareNames(i + 1, "=");
+            continue;
+        }
+        if (token.text == "function") {
+            warn(token, LintWarning::Severity::High,
+                 "Creates a new closure on every sample, the script body runs once per sample");
+            size_t open = i + 1;
+            while (open < tokens.size() && !isOp(open, "("))
+                open++;
+            declareNames(open + 1, ")");
+            blocks.push_back(Block::Other);
+            continue;
+        }
+        if (token.text == "for") {
+            declareNames(i + 1, "="); // also stops at `in`
+            blocks.push_back(Block::Loop);
+            pendingLoopDo++;
+            continue;
+        }
+        if (token.text == "while") {
+            blocks.push_back(Block::Loop);
+            pendingLoopDo++;
+            continue;
+        }
+        if (token.text == "repeat") {
+            blocks.push_back(Block::Loop);
+            continue;
+        }
+        if (token.text == "do") {
+            if (pendingLoopDo > 0)
+                pendingLoopDo--;
+            else
+                blocks.push_back(Block::Other);
+            continue;
+        }
+        if (token.text == "if") {
+            blocks.push_back(Block::Other);
+            continue;
+        }
+        if (token.text == "end" || token.text == "until") {
+            if (!blocks.empty())
+                blocks.pop_back();
+            continue;
+        }
+        if (keywords.count(token.text))
+            continue;
+
+        // Field and method names, labels
+        if (i > 0 && (isOp(i - 1, ".") || isOp(i - 1, ":") || isOp(i - 1, "::") || tokens[i - 1].text == "goto"))
+            continue;
+        // Keys in table constructors
+        if (i > 0 && !brackets.empty() && brackets.back() == '{'
+            && (isOp(i - 1, "{") || isOp(i - 1, ",") || isOp(i - 1, ";")) && isOp(i + 1, "="))
+            continue;
+        if (locals.count(token.text))
+            continue;
+
+        if (libraryGlobals.count(token.text)) {
+            std::string function = token.text;
+            if (isOp(i + 1, ".") && isName(i + 2))
+                function += "." + tokens[i + 2].text;
+
+            if (token.text == "print") {
+                warn(token, LintWarning::Severity::High,
+                     "print runs on every sample, it formats a string and is not compiled by LuaJIT");
+            } else if (notCompiledFunctions.count(function) || notCompiledLibraries.count(token.text)) {
+                warn(token, LintWarning::Severity::High,
+                     function + " is not compiled by LuaJIT, the JIT falls back to the interpreter");
+            } else if (inLoop && function != token.text && reportedGlobals.insert(function).second) {
+                warn(token, LintWarning::Severity::Low,
+                     "Global lookup of " + function + " on every iteration, cache it in a local before the loop");
+            }
+            continue;
+        }
+
+        if (reportedGlobals.insert(token.text).second) {
+            warn(token, LintWarning::Severity::Low,
+                 "'" + token.text + "' is a global, every access is a table lookup. "
+                 "Use a local unless the value has to persist between samples");
+        }
+    }
+
+    std::stable_sort(warnings.begin(), warnings.end(), [](const LintWarning& a, const LintWarning& b) {
+        return std::make_tuple(static_cast<int>(b.severity), a.line, a.column)
+             < std::make_tuple(static_cast<int>(a.severity), b.line, b.column);
+    });
+
+    // One warning per message and line is enough
+    std::vector<LintWarning> unique;
+    std::set<std::pair<int, std::string>> seen;
+    for (auto& warning : warnings)
+        if (seen.insert({warning.line, warning.message}).second)
+            unique.push_back(std::move(warning));
+
+    return unique;
+}
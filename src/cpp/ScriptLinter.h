@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/// A performance hazard found in a script. The whole script runs once per sample, so
+/// anything that allocates, does IO or stops the JIT is paid for on every sample.
+struct LintWarning {
+    enum class Severity {
+        Low = 0,
+        Medium,
+        High
+    };
+
+    int line = 1;      // 1-based
+    int column = 1;    // 1-based
+    int length = 1;    // of the flagged token
+    Severity severity = Severity::Low;
+    std::string message;
+};
+
+/// Static analysis on the token stream of a script, so it also works on scripts that do not
+/// compile yet. Scoping is approximated: a `local` counts from its declaration to the end
+/// of the file.
+class ScriptLinter {
+public:
+    /// `hostGlobals` are names provided by the host, like `t`, which are not reported as globals.
+    /// Warnings are sorted by severity, most severe first, then by position.
+    static std::vector<LintWarning> lint(const std::string& source, const std::vector<std::string>& hostGlobals);
+};
@@ -0,0 +1,196 @@
+#include "ScriptRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+ScriptRecorder::ScriptRecorder(size_t ringCapacity)
+    : capacity(ringCapacity)
+{
+}
+
+ScriptRecorder::~ScriptRecorder() {
+    stop();
+}
+
+std::optional<std::string> ScriptRecorder::start(const std::string& path) {
+    stop();
+
+    {
+        std::scoped_lock lock(fileMutex);
+        file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return "Cannot write recording to " + path;
+
+        ScriptRecording::FileHeader header;
+        std::memcpy(header.magic, ScriptRecording::MAGIC, sizeof(header.magic));
+        header.version = ScriptRecording::VERSION;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    ring.resize(capacity);
+    readPosition = 0;
+    writePosition = 0;
+    droppedRecords = 0;
+
+    shouldExit = false;
+    thread = std::thread(&ScriptRecorder::run, this);
+
+    recording.store(true, std::memory_order_seq_cst);
+    return std::nullopt;
+}
+
+void ScriptRecorder::stop() {
+    recording.store(false, std::memory_order_seq_cst);
+
+    // A record the audio thread began before it saw the flag is finished first
+    while (writing.load(std::memory_order_seq_cst))
+        std::this_thread::yield();
+
+    if (thread.joinable()) {
+        {
+            std::scoped_lock lock(threadMutex);
+            shouldExit = true;
+        }
+        wakeUp.notify_all();
+        thread.join();
+    }
+
+    {
+        std::scoped_lock lock(fileMutex);
+        if (file.is_open()) {
+            flush();
+            file.close();
+        }
+    }
+
+    std::vector<char>().swap(ring);
+}
+
+void ScriptRecorder::recordCompile(int slot, uint64_t blockIndex, double compileTime, bool failed,
+                                   const std::string& script, const std::optional<std::string>& packagePath) {
+    ScriptRecording::CompilePayload payload{};
+    payload.blockIndex = blockIndex;
+    payload.compileTime = compileTime;
+    payload.scriptLength = static_cast<uint32_t>(script.size());
+    payload.packagePathLength = packagePath ? static_cast<uint32_t>(packagePath->size()) : 0;
+    payload.failed = failed ? 1 : 0;
+    payload.hasPackagePath = packagePath ? 1 : 0;
+
+    if (!beginRecord(ScriptRecording::RecordType::Compile, slot,
+                     sizeof(payload) + payload.scriptLength + payload.packagePathLength))
+        return;
+
+    append(&payload, sizeof(payload));
+    append(script.data(), script.size());
+    if (packagePath)
+        append(packagePath->data(), packagePath->size());
+    commitRecord();
+}
+
+void ScriptRecorder::recordBlock(int slot, uint64_t blockIndex, double sampleRate, double startTime, double evaluationTime,
+                                 const AudioFeatures* features, int numFeatureChannels,
+                                 const double* const* outputs, int numChannels, int numSamples) {
+    ScriptRecording::BlockPayload payload{};
+    payload.blockIndex = blockIndex;
+    payload.sampleRate = sampleRate;
+    payload.startTime = startTime;
+    payload.evaluationTime = evaluationTime;
+    payload.numSamples = static_cast<uint32_t>(numSamples);
+    payload.numChannels = static_cast<uint8_t>(numChannels);
+    payload.numFeatureChannels = static_cast<uint8_t>(numFeatureChannels);
+
+    const size_t featuresSize = static_cast<size_t>(numFeatureChannels) * sizeof(AudioFeatures);
+    const size_t outputsSize = static_cast<size_t>(numChannels) * static_cast<size_t>(numSamples) * sizeof(float);
+    if (!beginRecord(ScriptRecording::RecordType::Block, slot, sizeof(payload) + featuresSize + outputsSize))
+        return;
+
+    append(&payload, sizeof(payload));
+    append(features, featuresSize);
+
+    // Results are stored as float, which is what parameters and MIDI resolve anyway
+    float converted[256];
+    for (int c = 0; c < numChannels; c++) {
+        for (int i = 0; i < numSamples; i += 256) {
+            const int n = std::min(256, numSamples - i);
+            for (int k = 0; k < n; k++)
+                converted[k] = static_cast<float>(outputs[c][i + k]);
+            append(converted, static_cast<size_t>(n) * sizeof(float));
+        }
+    }
+    commitRecord();
+}
+
+void ScriptRecorder::recordProcessBlock(uint64_t blockIndex, double processTime) {
+    ScriptRecording::ProcessBlockPayload payload{ blockIndex, processTime };
+    if (!beginRecord(ScriptRecording::RecordType::ProcessBlock, 0, sizeof(payload)))
+        return;
+
+    append(&payload, sizeof(payload));
+    commitRecord();
+}
+
+bool ScriptRecorder::beginRecord(ScriptRecording::RecordType type, int slot, size_t payloadSize) {
+    // Announced before checking the flag, so stop() cannot free the ring under the record
+    writing.store(true, std::memory_order_seq_cst);
+    if (!recording.load(std::memory_order_seq_cst)) {
+        writing.store(false, std::memory_order_release);
+        return false;
+    }
+
+    const size_t size = sizeof(ScriptRecording::RecordHeader) + payloadSize;
+    pendingPosition = writePosition.load(std::memory_order_relaxed);
+    const uint64_t used = pendingPosition - readPosition.load(std::memory_order_acquire);
+    if (ring.size() - used < size) {
+        droppedRecords++;
+        writing.store(false, std::memory_order_release);
+        return false;
+    }
+
+    ScriptRecording::RecordHeader header{ type, static_cast<uint8_t>(slot), 0, static_cast<uint32_t>(payloadSize) };
+    append(&header, sizeof(header));
+    return true;
+}
+
+void ScriptRecorder::append(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const size_t offset = static_cast<size_t>(pendingPosition % ring.size());
+        const size_t n = std::min(size, ring.size() - offset);
+        std::memcpy(ring.data() + offset, bytes, n);
+        bytes += n;
+        size -= n;
+        pendingPosition += n;
+    }
+}
+
+void ScriptRecorder::commitRecord() {
+    writePosition.store(pendingPosition, std::memory_order_release);
+    writing.store(false, std::memory_order_release);
+}
+
+void ScriptRecorder::run() {
+    std::unique_lock lock(threadMutex);
+    while (!shouldExit) {
+        wakeUp.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+
+        std::scoped_lock fileLock(fileMutex);
+        if (file.is_open())
+            flush();
+    }
+}
+
+void ScriptRecorder::flush() {
+    const uint64_t end = writePosition.load(std::memory_order_acquire);
+    uint64_t position = readPosition.load(std::memory_order_relaxed);
+
+    while (position < end) {
+        const size_t offset = static_cast<size_t>(position % ring.size());
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(end - position, ring.size() - offset));
+        file.write(ring.data() + offset, static_cast<std::streamsize>(n));
+        position += n;
+    }
+    file.flush();
+
+    readPosition.store(position, std::memory_order_release);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ScriptRecording.h"
+
+/// Opt-in recorder of everything the scripts saw and produced, for replaying a session offline.
+/// The audio thread writes records into a single-producer ring, a background thread flushes
+/// it to the file. Records that do not fit are dropped and counted, the audio thread never
+/// waits and never allocates. The ring and the thread only exist between start() and stop().
+///
+/// Only compiles and blocks are recorded, not the Lua state. A replay compiles every script
+/// into a fresh lua_State, so globals a running script set before start() are not part of
+/// the recording and its replay can differ from the live output until the script is compiled
+/// again.
+class ScriptRecorder {
+public:
+    explicit ScriptRecorder(size_t capacity = DEFAULT_CAPACITY);
+    ~ScriptRecorder();
+
+    ScriptRecorder(const ScriptRecorder&) = delete;
+    ScriptRecorder& operator=(const ScriptRecorder&) = delete;
+
+    /// Starts a new recording into `path`, stopping the current one. Allocates the ring and
+    /// starts the flush thread. Returns an error message on failure.
+    std::optional<std::string> start(const std::string& path);
+
+    /// Writes everything recorded so far, closes the file, stops the thread and frees the ring
+    void stop();
+
+    bool isRecording() const { return recording.load(std::memory_order_acquire); }
+
+    uint64_t getDroppedRecords() const { return droppedRecords.load(); }
+
+    // Audio thread only
+
+    void recordCompile(int slot, uint64_t blockIndex, double compileTime, bool failed,
+                       const std::string& script, const std::optional<std::string>& packagePath);
+
+    /// `outputs` holds `numChannels` pointers to `numSamples` results each
+    void recordBlock(int slot, uint64_t blockIndex, double sampleRate, double startTime, double evaluationTime,
+                     const AudioFeatures* features, int numFeatureChannels,
+                     const double* const* outputs, int numChannels, int numSamples);
+
+    void recordProcessBlock(uint64_t blockIndex, double processTime);
+
+    static constexpr size_t DEFAULT_CAPACITY = 8 << 20;
+    static constexpr int FLUSH_INTERVAL_MS = 50;
+
+private:
+    bool beginRecord(ScriptRecording::RecordType type, int slot, size_t payloadSize);
+    void append(const void* data, size_t size);
+    void commitRecord();
+
+    void run();
+    void flush(); // requires fileMutex
+
+    const size_t capacity;
+    std::vector<char> ring;
+    std::atomic<uint64_t> readPosition{0};
+    std::atomic<uint64_t> writePosition{0};
+    uint64_t pendingPosition = 0; // end of the record being written
+    std::atomic<bool> recording{false};
+    std::atomic<bool> writing{false}; // set by the audio thread while it uses the ring
+    std::atomic<uint64_t> droppedRecords{0};
+
+    std::mutex fileMutex;
+    std::ofstream file;
+
+    std::mutex threadMutex;
+    std::condition_variable wakeUp;
+    bool shouldExit = false;
+    std::thread thread;
+};
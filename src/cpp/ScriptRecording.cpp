@@ -0,0 +1,90 @@
+#include "ScriptRecording.h"
+
+#include <cstring>
+
+std::optional<std::string> ScriptRecordingReader::open(const std::string& path) {
+    file = std::ifstream(path, std::ios::binary);
+    if (!file)
+        return "Cannot open " + path;
+
+    ScriptRecording::FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, ScriptRecording::MAGIC, sizeof(header.magic)) != 0)
+        return path + " is not a script recording";
+
+    if (header.version != ScriptRecording::VERSION)
+        return "Unsupported recording version " + std::to_string(header.version);
+
+    return std::nullopt;
+}
+
+std::optional<RecordedEvent> ScriptRecordingReader::next() {
+    for (;;) {
+        ScriptRecording::RecordHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return std::nullopt;
+
+        payload.resize(header.size);
+        if (!file.read(payload.data(), static_cast<std::streamsize>(header.size)))
+            return std::nullopt;
+
+        const char* data = payload.data();
+
+        switch (header.type) {
+            case ScriptRecording::RecordType::Compile: {
+                ScriptRecording::CompilePayload p;
+                if (header.size < sizeof(p))
+                    return std::nullopt;
+                std::memcpy(&p, data, sizeof(p));
+                if (header.size < sizeof(p) + p.scriptLength + p.packagePathLength)
+                    return std::nullopt;
+
+                RecordedCompile event;
+                event.slot = header.slot;
+                event.blockIndex = p.blockIndex;
+                event.compileTime = p.compileTime;
+                event.failed = p.failed != 0;
+                event.script.assign(data + sizeof(p), p.scriptLength);
+                if (p.hasPackagePath)
+                    event.packagePath = std::string(data + sizeof(p) + p.scriptLength, p.packagePathLength);
+                return event;
+            }
+
+            case ScriptRecording::RecordType::Block: {
+                ScriptRecording::BlockPayload p;
+                if (header.size < sizeof(p))
+                    return std::nullopt;
+                std::memcpy(&p, data, sizeof(p));
+
+                const size_t featuresSize = p.numFeatureChannels * sizeof(AudioFeatures);
+                const size_t outputsSize = static_cast<size_t>(p.numChannels) * p.numSamples * sizeof(float);
+                if (header.size < sizeof(p) + featuresSize + outputsSize)
+                    return std::nullopt;
+
+                RecordedBlock event;
+                event.slot = header.slot;
+                event.blockIndex = p.blockIndex;
+                event.sampleRate = p.sampleRate;
+                event.startTime = p.startTime;
+                event.evaluationTime = p.evaluationTime;
+                event.numSamples = static_cast<int>(p.numSamples);
+                event.numChannels = p.numChannels;
+                event.features.resize(p.numFeatureChannels);
+                std::memcpy(event.features.data(), data + sizeof(p), featuresSize);
+                event.outputs.resize(static_cast<size_t>(p.numChannels) * p.numSamples);
+                std::memcpy(event.outputs.data(), data + sizeof(p) + featuresSize, outputsSize);
+                return event;
+            }
+
+            case ScriptRecording::RecordType::ProcessBlock: {
+                ScriptRecording::ProcessBlockPayload p;
+                if (header.size < sizeof(p))
+                    return std::nullopt;
+                std::memcpy(&p, data, sizeof(p));
+                return RecordedProcessBlock{ p.blockIndex, p.processTime };
+            }
+        }
+
+        // Unknown record types from newer versions are skipped
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "AudioFeatures.h"
+
+/// Binary format of script session recordings, written by ScriptRecorder and replayed by the
+/// replay tool. A file is a FileHeader followed by records, each a RecordHeader and `size`
+/// bytes of payload. Values are stored in native byte order.
+struct ScriptRecording {
+    static constexpr char MAGIC[4] = {'F', 'Z', 'R', 'C'};
+    static constexpr uint32_t VERSION = 1;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+    };
+
+    enum class RecordType : uint8_t {
+        Compile = 1,     // CompilePayload, script bytes, package path bytes
+        Block = 2,       // BlockPayload, AudioFeatures[numFeatureChannels], float outputs[numChannels][numSamples]
+        ProcessBlock = 3 // ProcessBlockPayload
+    };
+
+    struct RecordHeader {
+        RecordType type;
+        uint8_t slot;
+        uint16_t reserved;
+        uint32_t size;
+    };
+
+    struct CompilePayload {
+        uint64_t blockIndex;
+        double compileTime; // seconds
+        uint32_t scriptLength;
+        uint32_t packagePathLength;
+        uint8_t failed;
+        uint8_t hasPackagePath;
+        uint8_t reserved[6];
+    };
+
+    struct BlockPayload {
+        uint64_t blockIndex;
+        double sampleRate;
+        double startTime;      // value of `t` at the first sample
+        double evaluationTime; // seconds spent evaluating the slot
+        uint32_t numSamples;
+        uint8_t numChannels;
+        uint8_t numFeatureChannels;
+        uint16_t reserved;
+    };
+
+    struct ProcessBlockPayload {
+        uint64_t blockIndex;
+        double processTime; // seconds spent in processBlock, all slots included
+    };
+};
+
+struct RecordedCompile {
+    int slot;
+    uint64_t blockIndex;
+    double compileTime;
+    bool failed;
+    std::string script;
+    std::optional<std::string> packagePath;
+};
+
+struct RecordedBlock {
+    int slot;
+    uint64_t blockIndex;
+    double sampleRate;
+    double startTime;
+    double evaluationTime;
+    int numSamples;
+    int numChannels;
+    std::vector<AudioFeatures> features;
+    std::vector<float> outputs; // channel after channel
+};
+
+struct RecordedProcessBlock {
+    uint64_t blockIndex;
+    double processTime;
+};
+
+typedef std::variant<RecordedCompile, RecordedBlock, RecordedProcessBlock> RecordedEvent;
+
+/// Reads a recording one event at a time
+class ScriptRecordingReader {
+public:
+    /// Returns an error message if the file cannot be read or is not a recording
+    std::optional<std::string> open(const std::string& path);
+
+    /// Returns std::nullopt at the end of the file. A record cut off by a crash ends the file.
+    std::optional<RecordedEvent> next();
+
+private:
+    std::ifstream file;
+    std::vector<char> payload;
+};
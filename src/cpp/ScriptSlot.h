@@ -0,0 +1,118 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AudioFeatures.h"
+#include "LuaEnv.h"
+#include "MidiOutputEncoder.h"
+#include "OutputChain.h"
+
+/// A script compiled off the audio thread into its own fresh LuaEnv, with its modules loaded
+struct CompiledScript {
+    std::unique_ptr<LuaEnv> luaEnv; // taken from the LuaEnvPool
+    int timeVariable = 0;    // `t`, seconds since playback started
+    int channelVariable = 0; // `ch`, index of the evaluated channel, 0 when evaluating per frame
+
+    std::string script;
+    std::optional<std::string> packagePath;
+    std::vector<OutputLogMessage> messages; // errors and print() output while compiling
+    double compileTime = 0.0; // seconds
+    bool failed = false;
+};
+
+/// Messages of one slot evaluation, stored without allocating so they can be added on the
+/// audio and worker threads. Messages beyond MAX_MESSAGES are counted as dropped, text beyond
+/// MAX_LENGTH is cut.
+struct SlotMessages {
+    static constexpr size_t MAX_MESSAGES = LUAENV_OUTPUTLOG_MAX_MESSAGES;
+    static constexpr size_t MAX_LENGTH = 256;
+
+    struct Message {
+        OutputLogMessageType type = OutputLogMessageType::Text;
+        size_t length = 0;
+        std::array<char, MAX_LENGTH> text;
+
+        std::string_view getText() const { return { text.data(), length }; }
+    };
+
+    void add(std::string_view text, OutputLogMessageType type) {
+        if (size == messages.size()) {
+            dropped++;
+            return;
+        }
+
+        auto& message = messages[size++];
+        message.type = type;
+        message.length = std::min(text.size(), MAX_LENGTH);
+        std::copy_n(text.data(), message.length, message.text.data());
+    }
+
+    void clear() {
+        size = 0;
+        dropped = 0;
+    }
+
+    const Message* begin() const { return messages.data(); }
+    const Message* end() const { return messages.data() + size; }
+
+    std::array<Message, MAX_MESSAGES> messages;
+    size_t size = 0;
+    size_t dropped = 0; // since the last clear()
+};
+
+/// One independently compiled script with its own lua_State and output parameter.
+/// Slots are evaluated concurrently, so everything a slot touches while evaluating lives here.
+struct ScriptSlot {
+    ~ScriptSlot() {
+        delete pendingCompile.load();
+        delete retiredCompile.load();
+    }
+
+    /// Channels with their own outputs when evaluating per channel
+    static constexpr int MAX_OUTPUT_CHANNELS = 2;
+
+    /// Input channels scripts see as `input[0]` and `input[1]`
+    static constexpr int MAX_FEATURE_CHANNELS = 2;
+
+    std::mutex compileMutex;
+    std::optional<std::string> compileString;
+    std::optional<std::string> packagePath;
+    std::optional<std::string> lastSubmittedScript, lastSubmittedPackagePath; // compiled again when its modules change
+
+    // Compiled scripts are handed over without locks: the compiler publishes to pendingCompile,
+    // evaluation swaps it with `compiled` and passes the replaced one back in retiredCompile.
+    // A new script is only taken once the compiler has freed the previously retired one.
+    std::unique_ptr<CompiledScript> compiled; // evaluation only
+    std::atomic<CompiledScript*> pendingCompile{nullptr};
+    std::atomic<CompiledScript*> retiredCompile{nullptr};
+    std::optional<std::string> packagePathInUse; // compiler only, applies to every later compile
+
+    // Block to evaluate, set by the audio thread while the slot is not evaluating
+    int blockNumSamples = 0;
+    int blockNumChannels = 0; // evaluated channels, 1 when evaluating per frame
+    double blockStartTime = 0.0;
+    std::array<AudioFeatures, MAX_FEATURE_CHANNELS> blockFeatures{}; // bound as `input`, copied from the analysers
+
+    // Written during evaluation, read by the audio thread once the slot finished
+    bool active = false;
+    std::array<std::vector<double>, MAX_OUTPUT_CHANNELS> results;
+    int numResultChannels = 0;
+    SlotMessages messages;
+    bool newlyCompiled = false; // `compiled` was swapped in this block
+    std::atomic<bool> recordRunningScript{false}; // set when a recording starts, `compiled` is recorded at the next finished block
+    double evaluationTime = 0.0; // seconds
+
+    std::array<juce::AudioParameterFloat*, MAX_OUTPUT_CHANNELS> paramOutputs{};
+    std::array<MidiOutputEncoder, MAX_OUTPUT_CHANNELS> midiOutputEncoders;
+    std::array<OutputChain, MAX_OUTPUT_CHANNELS> outputChains;
+};
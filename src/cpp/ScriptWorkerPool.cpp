@@ -0,0 +1,152 @@
+#include "ScriptWorkerPool.h"
+
+#include <thread>
+
+ScriptWorkerPool::JobSet::JobSet(int jobs, std::function<void(int)> jobToRun)
+    : numJobs(jobs),
+      job(std::move(jobToRun)),
+      states(std::make_unique<std::atomic<int>[]>(static_cast<size_t>(jobs))),
+      scheduled(static_cast<size_t>(jobs), 0)
+{
+    for (int i = 0; i < numJobs; i++)
+        states[static_cast<size_t>(i)].store(Idle);
+}
+
+bool ScriptWorkerPool::JobSet::isFinished(int index) const {
+    return scheduled[static_cast<size_t>(index)] && isIdle(index);
+}
+
+bool ScriptWorkerPool::JobSet::isIdle(int index) const {
+    return states[static_cast<size_t>(index)].load(std::memory_order_acquire) == Idle;
+}
+
+void ScriptWorkerPool::JobSet::waitUntilIdle() const {
+    for (int i = 0; i < numJobs; i++)
+        while (!isIdle(i))
+            std::this_thread::yield();
+}
+
+bool ScriptWorkerPool::JobSet::runNext() {
+    for (int i = 0; i < numJobs; i++) {
+        int expected = Scheduled;
+        if (states[static_cast<size_t>(i)].compare_exchange_strong(expected, Running, std::memory_order_acq_rel)) {
+            job(i);
+            states[static_cast<size_t>(i)].store(Idle, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+ScriptWorkerPool::ScriptWorkerPool() {
+    // One core is left to the audio threads waiting for the workers
+    const int numWorkers = juce::jlimit(0, MAX_WORKERS, juce::SystemStats::getNumCpus() - 1);
+    for (int i = 0; i < numWorkers; i++) {
+        workers.push_back(std::make_unique<Worker>(*this));
+        workers.back()->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(10));
+    }
+}
+
+ScriptWorkerPool::~ScriptWorkerPool() {
+    for (auto& worker : workers) {
+        worker->signalThreadShouldExit();
+        worker->wakeUp.signal();
+    }
+    for (auto& worker : workers)
+        worker->stopThread(1000);
+}
+
+void ScriptWorkerPool::add(JobSet& jobs) {
+    for (auto& registered : jobSets) {
+        JobSet* expected = nullptr;
+        if (registered.compare_exchange_strong(expected, &jobs))
+            return;
+    }
+}
+
+void ScriptWorkerPool::remove(JobSet& jobs) {
+    for (auto& registered : jobSets) {
+        JobSet* expected = &jobs;
+        registered.compare_exchange_strong(expected, nullptr);
+    }
+
+    // A worker publishes the set it uses before checking it is still registered
+    for (auto& worker : workers)
+        while (worker->inUse.load() == &jobs)
+            std::this_thread::yield();
+}
+
+void ScriptWorkerPool::run(JobSet& jobs, double timeout) {
+    const auto deadline = juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks(timeout);
+
+    int numScheduled = 0;
+    for (int i = 0; i < jobs.numJobs; i++) {
+        const bool idle = jobs.isIdle(i);
+        if (idle) {
+            jobs.states[static_cast<size_t>(i)].store(JobSet::Scheduled, std::memory_order_release);
+            numScheduled++;
+        }
+        jobs.scheduled[static_cast<size_t>(i)] = idle;
+    }
+
+    // Busy workers look for more jobs before they wait again, only idle ones need waking
+    for (auto& worker : workers) {
+        if (numScheduled <= 0)
+            break;
+        if (!worker->busy.load()) {
+            worker->wakeUp.signal();
+            numScheduled--;
+        }
+    }
+
+    // A job the caller started could not be abandoned at the deadline, so it only takes jobs
+    // itself when there are no workers
+    if (workers.empty())
+        while (juce::Time::getHighResolutionTicks() < deadline && jobs.runNext()) {}
+
+    // Wait for the workers until the deadline
+    for (int i = 0; i < jobs.numJobs; i++)
+        while (jobs.scheduled[static_cast<size_t>(i)] && !jobs.isIdle(i)
+               && juce::Time::getHighResolutionTicks() < deadline)
+            std::this_thread::yield();
+
+    // Jobs nobody started in time are skipped this block
+    for (int i = 0; i < jobs.numJobs; i++) {
+        int expected = JobSet::Scheduled;
+        if (jobs.states[static_cast<size_t>(i)].compare_exchange_strong(expected, JobSet::Idle, std::memory_order_acq_rel))
+            jobs.scheduled[static_cast<size_t>(i)] = 0;
+    }
+}
+
+ScriptWorkerPool::Worker::Worker(ScriptWorkerPool& owner)
+    : juce::Thread("Script Worker"),
+      pool(owner)
+{
+}
+
+void ScriptWorkerPool::Worker::run() {
+    while (!threadShouldExit()) {
+        busy.store(false);
+        wakeUp.wait(-1);
+        busy.store(true);
+        while (!threadShouldExit() && runJobs()) {}
+    }
+}
+
+bool ScriptWorkerPool::Worker::runJobs() {
+    bool ranJob = false;
+
+    for (auto& registered : pool.jobSets) {
+        auto* jobs = registered.load();
+        if (jobs == nullptr)
+            continue;
+
+        inUse.store(jobs);
+        if (registered.load() == jobs)
+            while (jobs->runNext())
+                ranJob = true;
+        inUse.store(nullptr);
+    }
+
+    return ranJob;
+}
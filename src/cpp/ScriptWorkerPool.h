@@ -0,0 +1,88 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// Realtime priority threads evaluating script slots, one pool per process shared by every
+/// plugin instance through juce::SharedResourcePointer. Each instance registers a JobSet and
+/// runs it from its audio thread. Idle workers claim the next scheduled job of any registered
+/// set, so a slow job does not hold back the others.
+class ScriptWorkerPool {
+public:
+    /// A fixed number of jobs of one plugin instance. A job still running when run() gave up
+    /// on it finishes in the background and is not scheduled again until it has.
+    class JobSet {
+    public:
+        JobSet(int numJobs, std::function<void(int)> job);
+
+        JobSet(const JobSet&) = delete;
+        JobSet& operator=(const JobSet&) = delete;
+
+        /// True if the job ran to completion during the last run()
+        bool isFinished(int index) const;
+
+        /// True if the job is not running, so everything it uses may be changed
+        bool isIdle(int index) const;
+
+        /// Blocks until no job is running, e.g. before the data the jobs use is reallocated
+        void waitUntilIdle() const;
+
+    private:
+        friend class ScriptWorkerPool;
+
+        enum State { Idle, Scheduled, Running };
+
+        bool runNext(); // claims and runs one scheduled job, false if there was none
+
+        const int numJobs;
+        const std::function<void(int)> job;
+        std::unique_ptr<std::atomic<int>[]> states;
+        std::vector<char> scheduled; // by the last run(), audio thread only
+    };
+
+    ScriptWorkerPool();
+    ~ScriptWorkerPool();
+
+    ScriptWorkerPool(const ScriptWorkerPool&) = delete;
+    ScriptWorkerPool& operator=(const ScriptWorkerPool&) = delete;
+
+    /// Lets workers take jobs of `jobs`. If too many sets are registered the caller of run()
+    /// evaluates `jobs` on its own.
+    void add(JobSet& jobs);
+
+    /// Returns once no worker uses `jobs` anymore
+    void remove(JobSet& jobs);
+
+    /// Schedules every idle job of `jobs` and returns once they finished or `timeout` seconds
+    /// passed. Jobs nobody started by then are not run, see JobSet::isFinished().
+    /// The caller only runs jobs itself on a machine without workers (a single core); a job it
+    /// started then runs to completion, past the timeout if need be.
+    void run(JobSet& jobs, double timeout);
+
+    static constexpr int MAX_WORKERS = 8;
+    static constexpr size_t MAX_JOB_SETS = 64;
+
+private:
+    class Worker : public juce::Thread {
+    public:
+        explicit Worker(ScriptWorkerPool& pool);
+        void run() override;
+
+        juce::WaitableEvent wakeUp;
+        std::atomic<bool> busy{false}; // woken and looking for jobs
+        std::atomic<JobSet*> inUse{nullptr}; // keeps remove() from returning while jobs of the set run
+
+    private:
+        bool runJobs(); // one pass over every registered set, false if no job was run
+
+        ScriptWorkerPool& pool;
+    };
+
+    std::array<std::atomic<JobSet*>, MAX_JOB_SETS> jobSets{};
+    std::vector<std::unique_ptr<Worker>> workers;
+};
@@ -0,0 +1,97 @@
+#include "WebResourceProvider.h"
+
+#if EMBEDDED_WEB_ASSETS
+ #include "EmbeddedWebAssets.h"
+ #include "EmbeddedWebAssetPaths.h"
+#endif
+
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+const char* getMimeType(const juce::String& extension) {
+    static const std::unordered_map<std::string_view, const char*> mimeTypes = {
+        { ".html",  "text/html" },
+        { ".js",    "application/javascript" },
+        { ".mjs",   "application/javascript" },
+        { ".css",   "text/css" },
+        { ".json",  "application/json" },
+        { ".map",   "application/json" },
+        { ".svg",   "image/svg+xml" },
+        { ".png",   "image/png" },
+        { ".jpg",   "image/jpeg" },
+        { ".ico",   "image/x-icon" },
+        { ".woff",  "font/woff" },
+        { ".woff2", "font/woff2" },
+        { ".ttf",   "font/ttf" },
+        { ".wasm",  "application/wasm" },
+    };
+
+    auto it = mimeTypes.find(extension.toLowerCase().toRawUTF8());
+    return it != mimeTypes.end() ? it->second : "application/octet-stream";
+}
+
+/// Path below src/js/dist, starting with a slash
+juce::String getResourcePath(const juce::String& resourceName) {
+    auto path = resourceName.upToFirstOccurrenceOf("?", false, false);
+    return path.isEmpty() || path == "/" ? juce::String("/index.html") : path;
+}
+
+} // namespace
+
+#if EMBEDDED_WEB_ASSETS
+
+std::optional<juce::WebBrowserComponent::Resource> getWebResource(const juce::String& resourceName) {
+    struct Asset {
+        const std::byte* data;
+        size_t size;
+        const char* mimeType;
+    };
+
+    // Built once per process. juce_add_binary_data keys assets by file name, CMake generates the
+    // path of each file name and guarantees file names are unique.
+    static const std::unordered_map<std::string, Asset> assets = [] {
+        std::unordered_map<std::string, Asset> byFileName;
+        for (int i = 0; i < EmbeddedWebAssets::namedResourceListSize; i++) {
+            int size = 0;
+            auto* data = EmbeddedWebAssets::getNamedResource(EmbeddedWebAssets::namedResourceList[i], size);
+            juce::String fileName(EmbeddedWebAssets::originalFilenames[i]);
+            byFileName[fileName.toStdString()] = { reinterpret_cast<const std::byte*>(data),
+                                                   static_cast<size_t>(size),
+                                                   getMimeType(fileName.fromLastOccurrenceOf(".", true, false)) };
+        }
+
+        std::unordered_map<std::string, Asset> byPath;
+        for (const auto& assetPath : EmbeddedWebAssets::assetPaths)
+            if (auto it = byFileName.find(assetPath.fileName); it != byFileName.end())
+                byPath[assetPath.path] = it->second;
+        return byPath;
+    }();
+
+    auto it = assets.find(getResourcePath(resourceName).toStdString());
+    if (it == assets.end())
+        return std::nullopt;
+
+    const auto& asset = it->second;
+    return juce::WebBrowserComponent::Resource{ std::vector<std::byte>(asset.data, asset.data + asset.size), asset.mimeType };
+}
+
+#else
+
+std::optional<juce::WebBrowserComponent::Resource> getWebResource(const juce::String& resourceName) {
+    juce::File file(juce::String(SOURCE_DIR) + "/src/js/dist" + getResourcePath(resourceName));
+    if (!file.existsAsFile())
+        return std::nullopt;
+
+    // Read as bytes, binary assets must not go through juce::String
+    juce::MemoryBlock block;
+    if (!file.loadFileAsData(block))
+        return std::nullopt;
+
+    auto* data = static_cast<const std::byte*>(block.getData());
+    return juce::WebBrowserComponent::Resource{ std::vector<std::byte>(data, data + block.getSize()),
+                                                getMimeType(file.getFileExtension()) };
+}
+
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <juce_gui_extra/juce_gui_extra.h>
+
+#include <optional>
+
+/// Resource provider for the frontend WebView. When src/js/dist existed at configure time
+/// the built frontend is embedded in the binary and served from a static index, otherwise
+/// files are read from SOURCE_DIR/src/js/dist.
+std::optional<juce::WebBrowserComponent::Resource> getWebResource(const juce::String& resourceName);
@@ -33,12 +33,16 @@ function App() {
   const [theme, setTheme] = useState<"light" | "dark">(savedState?.theme || "light");
   const [selectedTab, setSelectedTab] = useState<string>(savedState?.selectedTab || "script");
   const editorRef = useRef<MonacoDiffEditor>(null);
+  const monacoRef = useRef<Monaco | null>(null);
   const outputLogRef = useRef<HTMLDivElement>(null);
   const [fileName, setFileName] = useState<string>(savedState?.fileName || "untitled.lua");
   const [outputLog, setOutputLog] = useState<string[][]>([["0 s"], ["0 s"]]);
   const [hasFileChanged, setHasFileChanged] = useState<boolean>(savedState?.hasFileChanged || false);
   const shouldUpdateOutputLogRef = useRef<boolean>(true);
   const [monitorData, setMonitorData] = useState<number[]>([]);
+  const [presets, setPresets] = useState<{ name: string, path: string, tags: string[] }[]>([]);
+  const [slot, setSlot] = useState<string>("0");
+  const [recording, setRecording] = useState<string | null>(null);
 
   /// TODO: load saved state from JSON init data, __JUCE__.backend.initialisationData.savedState
   /// TODO: update saved state via useEffect with each state
@@ -62,6 +66,23 @@ function App() {
         setMonitorData(e as number[]);
       });
 
+      window.__JUCE__.backend.addEventListener("lintUpdate", (e) => {
+        const monaco = monacoRef.current;
+        const model = monaco?.editor.getModels()[0];
+        if (!monaco || !model)
+          return;
+
+        const warnings = e as { line: number, column: number, length: number, severity: number, message: string }[];
+        monaco.editor.setModelMarkers(model, "performance", warnings.map((w) => ({
+          startLineNumber: w.line,
+          startColumn: w.column,
+          endLineNumber: w.line,
+          endColumn: w.column + w.length,
+          severity: w.severity > 0 ? monaco.MarkerSeverity.Warning : monaco.MarkerSeverity.Info,
+          message: w.message,
+        })));
+      });
+
       console.log("Saved state init: ", savedState);
     }
 
@@ -138,7 +159,10 @@ function App() {
             </Card>
             <Flex gap="3" direction="column" align="center" justify="center">
               <Flex gap="1">
-              <DropdownMenu.Root>
+              <DropdownMenu.Root onOpenChange={(open) => {
+                if (open)
+                  getNativeFunction("getPresetList")().then((list) => setPresets(list as { name: string, path: string, tags: string[] }[]));
+              }}>
                 <Tooltip content="Browse Presets">
                   <DropdownMenu.Trigger>
                     <IconButton variant="soft">⏷</IconButton>
@@ -147,8 +171,16 @@ function App() {
                 <DropdownMenu.Content size="1">
                   <DropdownMenu.Label>Presets</DropdownMenu.Label>
                   <DropdownMenu.Separator />
-                  <DropdownMenu.Item>Empty</DropdownMenu.Item>
-                  <DropdownMenu.Item>Basic LFO</DropdownMenu.Item>
+                  {
+                    presets.length === 0 ?
+                      <DropdownMenu.Item disabled>No presets found</DropdownMenu.Item>
+                      :
+                    presets.map((preset) => (
+                      <DropdownMenu.Item key={preset.path} onClick={() => getNativeFunction("loadPreset")(preset.path)}>
+                        {preset.name}{preset.tags.length > 0 ? <Text size="1" color="gray">{preset.tags.join(", ")}</Text> : null}
+                      </DropdownMenu.Item>
+                    ))
+                  }
                 </DropdownMenu.Content>
               </DropdownMenu.Root>
               <Tooltip content="Open File">
@@ -176,9 +208,16 @@ function App() {
                 </DropdownMenu.Content>
               </DropdownMenu.Root>
               </Flex>
-              <Button onClick={() => { getNativeFunction("compile")(editorRef.current?.getValue()); }}>
-                🞂 Compile
-              </Button>
+              <Flex gap="2" align="center">
+                <SegmentedControl.Root value={slot} onValueChange={setSlot} size="1">
+                  {[0, 1, 2, 3].map((i) =>
+                    <SegmentedControl.Item key={i} value={String(i)}>{i + 1}</SegmentedControl.Item>
+                  )}
+                </SegmentedControl.Root>
+                <Button onClick={() => { getNativeFunction("compile")(editorRef.current?.getValue(), Number(slot)); }}>
+                  🞂 Compile
+                </Button>
+              </Flex>
             </Flex>
           </Flex>
           </Box>
@@ -199,12 +238,15 @@ function App() {
                   defaultValue={savedState?.script || "print('Hello World!')"}
                   onMount={(editor: MonacoDiffEditor, monaco: Monaco) => {
                     editorRef.current = editor
+                    monacoRef.current = monaco
+                    getNativeFunction("lint")(editor.getValue())
                     editorRef.current.addCommand(monaco.KeyMod.CtrlCmd | monaco.KeyCode.KeyS, () => saveFile(true))
                     editorRef.current.addCommand(monaco.KeyMod.CtrlCmd | monaco.KeyMod.Shift | monaco.KeyCode.KeyS, () => saveFile(false))
                   }}
                   onChange={() => {
                     if (!hasFileChanged) setHasFileChanged(true);
                     getNativeFunction("setSavedState")({ script: editorRef.current?.getValue() });
+                    getNativeFunction("lint")(editorRef.current?.getValue());
                   }}
                 >
                 </Editor> 
@@ -255,6 +297,18 @@ function App() {
                   <SegmentedControl.Item value="light">Light</SegmentedControl.Item>
                   <SegmentedControl.Item value="dark">Dark</SegmentedControl.Item>
                 </SegmentedControl.Root>
+                <Flex gap="2" align="center" style={{ marginTop: 8 }}>
+                  <Switch checked={recording !== null} onCheckedChange={(v) => {
+                    getNativeFunction("setRecording")(v).then((result) => {
+                      const [ok, message] = (result as [boolean, string] | null) ?? [false, null];
+                      setRecording(ok ? message : null);
+                      if (!ok && message)
+                        console.error(message);
+                    });
+                  }}/>
+                  <Text size="2">Record session for replay</Text>
+                  {recording && <Code size="1">{recording}</Code>}
+                </Flex>
               </Tabs.Content>
             </Box>
           </Tabs.Root>
@@ -0,0 +1,204 @@
+// Replays a recording made by ScriptRecorder against LuaEnv, without a host or audio device.
+// Every compile and block is run again in order with the recorded inputs, the results are
+// compared to the recorded outputs and the slowest blocks are listed. Run it under a profiler
+// with --repeat to get enough samples.
+// Each compile starts from a fresh lua_State, live globals set before recording started are
+// not in the recording and not restored, so the first blocks of a script that was already
+// running can mismatch.
+//
+//   script_replay <recording.fzrec> [--repeat N] [--top N]
+
+#include "../cpp/LuaEnv.h"
+#include "../cpp/ScriptRecording.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int MAX_FEATURE_CHANNELS = 2; // same as the processor
+constexpr float TOLERANCE = 1e-6f;
+
+struct ReplaySlot {
+    std::unique_ptr<LuaEnv> luaEnv;
+    int timeVariable = 0;
+    int channelVariable = 0;
+};
+
+// Same as the processor's compileSlot: every compile gets a fresh state with its modules loaded
+void compileSlot(ReplaySlot& slot, const RecordedCompile& compile, std::array<AudioFeatures, MAX_FEATURE_CHANNELS>& features) {
+    slot.luaEnv = std::make_unique<LuaEnv>(LuaEnvLibraries::Sandboxed);
+    slot.luaEnv->print_callback = [](std::string) {};
+    slot.timeVariable = slot.luaEnv->registerVariable("t");
+    slot.channelVariable = slot.luaEnv->registerVariable("ch");
+    if (auto err = slot.luaEnv->bindStruct("input", AUDIO_FEATURES_CDEF, "AudioFeatures", features.data(), features.size()))
+        std::fprintf(stderr, "slot %d: %s\n", compile.slot, err->c_str());
+    if (auto err = slot.luaEnv->sandbox())
+        std::fprintf(stderr, "slot %d: %s\n", compile.slot, err->c_str());
+
+    if (compile.packagePath)
+        if (auto err = slot.luaEnv->setPackagePath(*compile.packagePath))
+            std::fprintf(stderr, "slot %d: %s\n", compile.slot, err->c_str());
+
+    if (!slot.luaEnv->compile(compile.script.c_str()))
+        slot.luaEnv->preloadModules(compile.script.c_str());
+}
+
+struct BlockTiming {
+    int slot;
+    uint64_t blockIndex;
+    double recordedTime;
+    double replayedTime;
+};
+
+struct ReplayStats {
+    size_t compiles = 0;
+    size_t blocks = 0;
+    size_t mismatches = 0;
+    std::vector<BlockTiming> timings;
+    std::vector<RecordedProcessBlock> processBlocks;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool replay(const char* path, std::array<AudioFeatures, MAX_FEATURE_CHANNELS>& features, ReplayStats& stats) {
+    ScriptRecordingReader reader;
+    if (auto err = reader.open(path)) {
+        std::fprintf(stderr, "%s\n", err->c_str());
+        return false;
+    }
+
+    std::map<int, ReplaySlot> slots;
+
+    std::vector<double> results;
+
+    while (auto event = reader.next()) {
+        if (auto* compile = std::get_if<RecordedCompile>(&*event)) {
+            auto& slot = slots[compile->slot];
+            compileSlot(slot, *compile, features);
+
+            const bool failed = !slot.luaEnv->hasInstance();
+            if (failed != compile->failed)
+                std::fprintf(stderr, "block %llu slot %d: compile %s, but %s when recorded\n",
+                             static_cast<unsigned long long>(compile->blockIndex), compile->slot,
+                             failed ? "failed" : "succeeded", compile->failed ? "failed" : "succeeded");
+            stats.compiles++;
+        }
+        else if (auto* block = std::get_if<RecordedBlock>(&*event)) {
+            auto& slot = slots[block->slot];
+            if (!slot.luaEnv)
+                continue; // evaluated before the slot's first recorded compile
+
+            std::fill(features.begin(), features.end(), AudioFeatures{});
+            std::copy_n(block->features.begin(), std::min<size_t>(block->features.size(), features.size()), features.begin());
+
+            results.resize(static_cast<size_t>(block->numSamples));
+            double replayedTime = 0.0;
+            float maxDifference = 0.0f;
+            int nanMismatches = 0; // std::max ignores NaN differences, so they are counted apart
+
+            for (int c = 0; c < block->numChannels; c++) {
+                const auto start = std::chrono::steady_clock::now();
+                slot.luaEnv->setVariable(slot.timeVariable, block->startTime, 1.0 / block->sampleRate);
+                slot.luaEnv->setVariable(slot.channelVariable, c);
+                slot.luaEnv->runBlock(results.data(), block->numSamples);
+                replayedTime += secondsSince(start);
+
+                const float* recorded = block->outputs.data() + static_cast<size_t>(c) * block->numSamples;
+                for (int i = 0; i < block->numSamples; i++) {
+                    const float replayed = static_cast<float>(results[i]);
+                    if (std::isnan(replayed) != std::isnan(recorded[i]))
+                        nanMismatches++;
+                    else
+                        maxDifference = std::max(maxDifference, std::abs(replayed - recorded[i]));
+                }
+            }
+
+            if (maxDifference > TOLERANCE || nanMismatches > 0) {
+                if (stats.mismatches < 10)
+                    std::fprintf(stderr, "block %llu slot %d: outputs differ by up to %g, %d samples NaN in only one of them\n",
+                                 static_cast<unsigned long long>(block->blockIndex), block->slot, maxDifference, nanMismatches);
+                stats.mismatches++;
+            }
+
+            stats.blocks++;
+            stats.timings.push_back({ block->slot, block->blockIndex, block->evaluationTime, replayedTime });
+        }
+        else if (auto* processBlock = std::get_if<RecordedProcessBlock>(&*event)) {
+            stats.processBlocks.push_back(*processBlock);
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <recording.fzrec> [--repeat N] [--top N]\n", argv[0]);
+        return 1;
+    }
+
+    int repeat = 1;
+    size_t top = 10;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--repeat") == 0)
+            repeat = std::max(1, std::atoi(argv[i + 1]));
+        else if (std::strcmp(argv[i], "--top") == 0)
+            top = static_cast<size_t>(std::max(0, std::atoi(argv[i + 1])));
+    }
+
+    std::array<AudioFeatures, MAX_FEATURE_CHANNELS> features{};
+    ReplayStats stats;
+    for (int pass = 0; pass < repeat; pass++) {
+        // Only the last pass is reported, earlier ones warm up the JIT
+        stats = ReplayStats{};
+        if (!replay(argv[1], features, stats))
+            return 1;
+    }
+
+    double total = 0.0, recordedTotal = 0.0, max = 0.0;
+    for (const auto& timing : stats.timings) {
+        total += timing.replayedTime;
+        recordedTotal += timing.recordedTime;
+        max = std::max(max, timing.replayedTime);
+    }
+
+    std::printf("%zu compiles, %zu slot blocks, %zu mismatching\n", stats.compiles, stats.blocks, stats.mismatches);
+    if (!stats.timings.empty())
+        std::printf("slot evaluation: replayed %.3f ms total (max %.3f ms), recorded %.3f ms total\n",
+                    total * 1000.0, max * 1000.0, recordedTotal * 1000.0);
+
+    std::sort(stats.timings.begin(), stats.timings.end(), [](const BlockTiming& a, const BlockTiming& b) {
+        return a.recordedTime > b.recordedTime;
+    });
+    std::printf("\nslowest recorded slot blocks:\n");
+    for (size_t i = 0; i < std::min(top, stats.timings.size()); i++) {
+        const auto& timing = stats.timings[i];
+        std::printf("  block %8llu slot %d: recorded %.3f ms, replayed %.3f ms\n",
+                    static_cast<unsigned long long>(timing.blockIndex), timing.slot,
+                    timing.recordedTime * 1000.0, timing.replayedTime * 1000.0);
+    }
+
+    std::sort(stats.processBlocks.begin(), stats.processBlocks.end(), [](const RecordedProcessBlock& a, const RecordedProcessBlock& b) {
+        return a.processTime > b.processTime;
+    });
+    std::printf("\nslowest recorded processBlock calls:\n");
+    for (size_t i = 0; i < std::min(top, stats.processBlocks.size()); i++)
+        std::printf("  block %8llu: %.3f ms\n", static_cast<unsigned long long>(stats.processBlocks[i].blockIndex),
+                    stats.processBlocks[i].processTime * 1000.0);
+
+    return stats.mismatches > 0 ? 2 : 0;
+}
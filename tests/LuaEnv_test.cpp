@@ -1,6 +1,12 @@
 #include <gtest/gtest.h>
 
 #include "../src/cpp/LuaEnv.h"
+#include "../src/cpp/LuaBytecodeCache.h"
+#include "../src/cpp/LuaEnvPool.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
 
 TEST(LuaEnvTest, CompileSuccess) {
     LuaEnv L;
@@ -108,4 +114,296 @@ TEST(LuaEnvTest, OutputLogOverflow) {
     EXPECT_EQ(logger.messages.size(), LUAENV_OUTPUTLOG_MAX_MESSAGES);
     EXPECT_EQ(logger.messages.front().str, "Hello World!");
     EXPECT_EQ(logger.messages.back().str, "bar");
-}
\ No newline at end of file
+}
+
+TEST(LuaEnvTest, NativeExpressionDetection) {
+    LuaEnv L;
+    L.registerVariable("t");
+
+    EXPECT_EQ(L.compile("return math.sin(t * 2 * math.pi) * 0.5"), std::nullopt);
+    EXPECT_TRUE(L.hasNativeInstance());
+    EXPECT_EQ(L.compile("return 42 -- answer"), std::nullopt);
+    EXPECT_TRUE(L.hasNativeInstance());
+
+    EXPECT_EQ(L.compile("print('Hello World!')"), std::nullopt);
+    EXPECT_FALSE(L.hasNativeInstance()); // statements fall back to LuaJIT
+    EXPECT_EQ(L.compile("return x * 2"), std::nullopt);
+    EXPECT_FALSE(L.hasNativeInstance()); // unregistered globals fall back to LuaJIT
+    EXPECT_EQ(L.compile("return math.random()"), std::nullopt);
+    EXPECT_FALSE(L.hasNativeInstance()); // impure functions fall back to LuaJIT
+    EXPECT_NE(L.compile("return 1 +"), std::nullopt);
+    EXPECT_FALSE(L.hasNativeInstance());
+}
+
+TEST(LuaEnvTest, NativeExpressionMatchesLua) {
+    LuaEnv L;
+    int t = L.registerVariable("t");
+
+    const char* scripts[] = {
+        "return -2^2 + 2^3^2",
+        "return 7 % 3 + -7 % 3 - 5.5 % -2",
+        "return math.max(1, t, 3) + math.min(t, 0.25) + math.fmod(7, 3)",
+        "return math.floor(t * 10) / 10 + math.abs(-t) + math.sqrt(t)",
+        "return math.sin(t * 2 * math.pi * 3) * 0.5 + math.cos(t) ^ 2",
+    };
+
+    for (const char* script : scripts) {
+        // Run the same expression through LuaJIT by wrapping it in a statement
+        std::string luaScript = std::string("local r = ") + (script + 7) + "\nreturn r";
+
+        for (double time : { 0.0, 0.1, 0.37, 2.5 }) {
+            L.setVariable(t, time);
+
+            EXPECT_EQ(L.compile(script), std::nullopt);
+            ASSERT_TRUE(L.hasNativeInstance()) << script;
+            double native = L.runInstance().result;
+
+            EXPECT_EQ(L.compile(luaScript.c_str()), std::nullopt);
+            ASSERT_FALSE(L.hasNativeInstance());
+            EXPECT_DOUBLE_EQ(native, L.runInstance().result) << script << " t=" << time;
+        }
+    }
+}
+
+TEST(LuaEnvTest, RunBlock) {
+    LuaEnv L;
+    int t = L.registerVariable("t");
+    double native[300], lua[300];
+
+    EXPECT_EQ(L.compile("return t * 2"), std::nullopt);
+    EXPECT_TRUE(L.hasNativeInstance());
+    L.setVariable(t, 1.0, 0.5);
+    EXPECT_EQ(L.runBlock(native, 300), std::nullopt);
+
+    EXPECT_EQ(L.compile("local r = t * 2 return r"), std::nullopt);
+    EXPECT_FALSE(L.hasNativeInstance());
+    L.setVariable(t, 1.0, 0.5);
+    EXPECT_EQ(L.runBlock(lua, 300), std::nullopt);
+
+    for (int i = 0; i < 300; i++) {
+        EXPECT_DOUBLE_EQ(native[i], 2.0 * (1.0 + 0.5 * i));
+        EXPECT_DOUBLE_EQ(lua[i], native[i]);
+    }
+
+    // Variables continue from the end of the previous block
+    EXPECT_DOUBLE_EQ(L.runInstance().result, 2.0 * (1.0 + 0.5 * 300));
+
+    EXPECT_EQ(L.compile("error('boom')"), std::nullopt);
+    EXPECT_NE(L.runBlock(lua, 16), std::nullopt);
+    EXPECT_EQ(lua[15], 0.0); // failed samples are zeroed
+}
+
+TEST(LuaEnvTest, BindStruct) {
+    LuaEnv L;
+
+    struct Pair { float a, b; } pairs[2] = { { 1.0f, 2.0f }, { 3.0f, 4.5f } };
+    EXPECT_EQ(L.bindStruct("pairs", "typedef struct { float a, b; } Pair;", "Pair", pairs, 2), std::nullopt);
+
+    EXPECT_EQ(L.compile("return pairs[1].b"), std::nullopt);
+    EXPECT_EQ(L.runInstance().result, 4.5);
+
+    pairs[1].b = 8.0f;
+    EXPECT_EQ(L.runInstance().result, 8.0); // scripts read the native memory directly
+
+    EXPECT_EQ(L.compile("pairs[0].a = 2"), std::nullopt);
+    EXPECT_NE(L.runInstance().error, std::nullopt); // read-only
+    EXPECT_EQ(pairs[0].a, 1.0f);
+
+    // Indexing is bounds-checked, the native memory around the elements stays out of reach
+    for (const char* outOfRange : { "return pairs[2].a", "return pairs[-1].a", "return pairs[0.5].a", "return pairs.a" }) {
+        EXPECT_EQ(L.compile(outOfRange), std::nullopt);
+        EXPECT_NE(L.runInstance().error, std::nullopt) << outOfRange;
+    }
+    EXPECT_EQ(L.compile("pairs[0] = 1"), std::nullopt);
+    EXPECT_NE(L.runInstance().error, std::nullopt);
+
+    // Binding again in the same state does not fail on the repeated declaration
+    EXPECT_EQ(L.bindStruct("pairs2", "typedef struct { float a, b; } Pair;", "Pair", pairs, 2), std::nullopt);
+
+    // Errors in a new declaration are not swallowed
+    EXPECT_NE(L.bindStruct("broken", "typedef struct { flaot a; } Broken;", "Broken", pairs, 2), std::nullopt);
+    EXPECT_NE(L.bindStruct("missing", "typedef struct { float a; } Declared;", "Missing", pairs, 2), std::nullopt);
+}
+
+TEST(LuaEnvTest, BytecodeCacheSharedBetweenEnvs) {
+    LuaBytecodeCache::getInstance().clear();
+
+    LuaEnv L1, L2;
+    EXPECT_EQ(L1.compile("local a = 40 return a + 2"), std::nullopt);
+    size_t cached = LuaBytecodeCache::getInstance().size();
+    EXPECT_GT(cached, 0u);
+
+    EXPECT_EQ(L2.compile("local a = 40 return a + 2"), std::nullopt);
+    EXPECT_EQ(LuaBytecodeCache::getInstance().size(), cached); // second env reuses the bytecode
+    EXPECT_EQ(L2.runInstance().result, 42.0);
+
+    EXPECT_NE(L2.compile("ret 42"), std::nullopt); // errors are still reported
+    EXPECT_EQ(L2.hasInstance(), false);
+}
+
+TEST(LuaEnvTest, BytecodeCacheEvictsLeastRecentlyUsed) {
+    auto& cache = LuaBytecodeCache::getInstance();
+    cache.clear();
+
+    const std::string first = "return 0";
+    EXPECT_TRUE(cache.precompile(first));
+    for (size_t i = 1; i <= LuaBytecodeCache::MAX_ENTRIES; i++) {
+        EXPECT_TRUE(cache.precompile("return " + std::to_string(i)));
+        EXPECT_TRUE(cache.precompile(first)); // keeps it the most recently used
+    }
+
+    EXPECT_EQ(cache.size(), LuaBytecodeCache::MAX_ENTRIES);
+    EXPECT_TRUE(cache.contains(first));
+    EXPECT_FALSE(cache.contains("return 1")); // the oldest one went
+    EXPECT_TRUE(cache.contains("return " + std::to_string(LuaBytecodeCache::MAX_ENTRIES)));
+}
+
+TEST(LuaEnvTest, BytecodeCacheModuleInvalidation) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "luaenv_test_modules";
+    fs::create_directories(dir);
+    fs::path module = dir / "cachedmodule.lua";
+
+    std::ofstream(module) << "return 5";
+    LuaEnv L1;
+    EXPECT_EQ(L1.setPackagePath(dir.string()), std::nullopt);
+    EXPECT_EQ(L1.compile("return require('cachedmodule')"), std::nullopt);
+    EXPECT_EQ(L1.runInstance().result, 5.0);
+
+    std::ofstream(module) << "return 6";
+    fs::last_write_time(module, fs::last_write_time(module) + std::chrono::seconds(2));
+    LuaEnv L2;
+    EXPECT_EQ(L2.setPackagePath(dir.string()), std::nullopt);
+    EXPECT_EQ(L2.compile("return require('cachedmodule')"), std::nullopt);
+    EXPECT_EQ(L2.runInstance().result, 6.0); // changed file is not served from the cache
+
+    fs::remove_all(dir);
+}
+
+TEST(LuaEnvTest, ModulesReloadOnCompile) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "luaenv_test_reload";
+    fs::create_directories(dir);
+    fs::path module = dir / "reloadmodule.lua";
+
+    LuaEnv L;
+    EXPECT_EQ(L.setPackagePath(dir.string()), std::nullopt);
+
+    std::ofstream(module) << "return 1";
+    EXPECT_EQ(L.compile("return require('reloadmodule')"), std::nullopt);
+    EXPECT_EQ(L.runInstance().result, 1.0);
+
+    std::ofstream(module) << "return 2";
+    fs::last_write_time(module, fs::last_write_time(module) + std::chrono::seconds(2));
+    EXPECT_EQ(L.runInstance().result, 1.0); // still the loaded module until the next compile
+    EXPECT_EQ(L.compile("return require('reloadmodule')"), std::nullopt);
+    EXPECT_EQ(L.runInstance().result, 2.0);
+
+    fs::remove_all(dir);
+}
+
+TEST(LuaEnvTest, FindRequires) {
+    EXPECT_EQ(LuaEnv::findRequires("local a = require('a') local b = require \"b.c\" return require ( 'a' )"),
+              (std::vector<std::string>{ "a", "b.c" }));
+    EXPECT_EQ(LuaEnv::findRequires("local r = require return r(name)"), std::vector<std::string>{});
+}
+
+TEST(LuaEnvTest, PreloadModules) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "luaenv_test_preload";
+    fs::create_directories(dir);
+    fs::path module = dir / "preloadmodule.lua";
+    std::ofstream(module) << "counter = (counter or 0) + 1 return 3";
+
+    LuaEnv L;
+    EXPECT_EQ(L.setPackagePath(dir.string()), std::nullopt);
+    const char* script = "return require('preloadmodule') + counter";
+    EXPECT_EQ(L.compile(script), std::nullopt);
+    EXPECT_EQ(L.preloadModules(script), std::nullopt);
+
+    fs::remove_all(dir); // already loaded, running needs no file
+    EXPECT_EQ(L.runInstance().result, 4.0);
+
+    EXPECT_NE(L.preloadModules("return require('missingmodule')"), std::nullopt);
+}
+
+TEST(LuaEnvTest, LibrarySets) {
+    LuaEnv full;
+    EXPECT_EQ(full.compile("return (io and os and debug) and 1 or 0"), std::nullopt);
+    EXPECT_EQ(full.runInstance().result, 1.0);
+
+    LuaEnv sandboxed(LuaEnvLibraries::Sandboxed);
+    EXPECT_EQ(sandboxed.compile("return (io or os or debug) and 1 or 0"), std::nullopt);
+    EXPECT_EQ(sandboxed.runInstance().result, 0.0);
+    EXPECT_EQ(sandboxed.compile("return math.floor(2.5) + bit.band(3, 1) + #string.rep('a', 2)"), std::nullopt);
+    EXPECT_EQ(sandboxed.runInstance().result, 5.0);
+
+    // Required libraries are always opened
+    LuaEnv minimal(0);
+    EXPECT_EQ(minimal.getLibraries(), LuaEnvLibraries::Required);
+    EXPECT_EQ(minimal.compile("return jit.status() and 1 or 0"), std::nullopt);
+    EXPECT_EQ(minimal.runInstance().result, 1.0);
+
+    // ffi only when requested
+    EXPECT_EQ(minimal.compile("return pcall(require, 'ffi') and 1 or 0"), std::nullopt);
+    EXPECT_EQ(minimal.runInstance().result, 0.0);
+    const double value = 1.0;
+    EXPECT_NE(minimal.bindStruct("value", "typedef struct { double v; } Value;", "Value", &value, 1), std::nullopt);
+    EXPECT_EQ(sandboxed.bindStruct("value", "typedef struct { double v; } Value;", "Value", &value, 1), std::nullopt);
+
+    EXPECT_GT(minimal.getCreationMemoryUsage(), 0u);
+    EXPECT_LT(minimal.getCreationMemoryUsage(), full.getCreationMemoryUsage());
+}
+
+TEST(LuaEnvTest, SandboxRemovesNativeAccess) {
+    LuaEnv L(LuaEnvLibraries::Sandboxed);
+    const double value = 3.0;
+    ASSERT_EQ(L.bindStruct("value", "typedef struct { double v; } Value;", "Value", &value, 1), std::nullopt);
+    ASSERT_EQ(L.sandbox(), std::nullopt);
+
+    for (const char* removed : { "require('ffi').C", "require('ffi').load", "package.loadlib", "dofile", "loadfile",
+                                 "package.loaders[4]" }) {
+        EXPECT_EQ(L.compile((std::string("return ") + removed + " == nil and 1 or 0").c_str()), std::nullopt);
+        EXPECT_EQ(L.runInstance().result, 1.0) << removed;
+    }
+
+    // Source still loads, bytecode does not
+    EXPECT_EQ(L.compile("return loadstring('return 2')() + load('return 3')()"), std::nullopt);
+    EXPECT_EQ(L.runInstance().result, 5.0);
+    EXPECT_EQ(L.compile("return (loadstring(string.dump(function() return 1 end)) or load(string.dump(function() return 1 end))) and 1 or 0"), std::nullopt);
+    EXPECT_EQ(L.runInstance().result, 0.0);
+
+    // Bound structs keep working
+    EXPECT_EQ(L.compile("return value[0].v"), std::nullopt);
+    EXPECT_EQ(L.runInstance().result, 3.0);
+}
+
+TEST(LuaEnvTest, PoolPreparesStates) {
+    LuaEnvPool pool;
+    const unsigned libraries = LuaEnvLibraries::Required | LuaEnvLibraries::Math;
+
+    pool.reserve(libraries, 2);
+    for (int i = 0; i < 500 && pool.available(libraries) < 2; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(pool.available(libraries), 2u);
+
+    auto env = pool.acquire(libraries);
+    ASSERT_NE(env, nullptr);
+    EXPECT_EQ(env->getLibraries(), libraries);
+    EXPECT_EQ(env->compile("return math.abs(-3)"), std::nullopt);
+    EXPECT_EQ(env->runInstance().result, 3.0);
+
+    // Refilled in the background
+    for (int i = 0; i < 500 && pool.available(libraries) < 2; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(pool.available(libraries), 2u);
+
+    // Reservations of several instances add up, releasing one frees its states
+    pool.reserve(libraries, 2);
+    for (int i = 0; i < 500 && pool.available(libraries) < 4; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(pool.available(libraries), 4u);
+
+    pool.release(libraries, 2);
+    EXPECT_EQ(pool.available(libraries), 2u);
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include "../src/cpp/MidiOutputEncoder.h"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+struct Message {
+    std::array<uint8_t, 3> bytes;
+    int sampleOffset;
+
+    bool operator==(const Message& other) const { return bytes == other.bytes && sampleOffset == other.sampleOffset; }
+};
+
+std::vector<Message> encode(MidiOutputEncoder& encoder, const std::vector<double>& values,
+                            MidiOutputEncoder::Mode mode, int channel, int controller, int threshold,
+                            int minInterval = 0) {
+    std::vector<Message> messages;
+    encoder.process(values.data(), static_cast<int>(values.size()),
+                    [&messages](const uint8_t* bytes, int size, int sampleOffset) {
+                        EXPECT_EQ(size, 3);
+                        messages.push_back({ { bytes[0], bytes[1], bytes[2] }, sampleOffset });
+                    },
+                    mode, channel, controller, threshold, minInterval);
+    return messages;
+}
+
+} // namespace
+
+TEST(MidiOutputEncoderTest, ControlChange) {
+    MidiOutputEncoder encoder;
+    auto messages = encode(encoder, { -1.0, 0.0, 1.0, 2.0 }, MidiOutputEncoder::Mode::ControlChange, 2, 20, 1);
+
+    // 0 rounds to 64, out of range values are clamped and 127 is not sent twice
+    EXPECT_EQ(messages, (std::vector<Message>{
+        { { 0xb1, 20, 0 }, 0 },
+        { { 0xb1, 20, 64 }, 1 },
+        { { 0xb1, 20, 127 }, 2 },
+    }));
+}
+
+TEST(MidiOutputEncoderTest, ControlChange14Bit) {
+    MidiOutputEncoder encoder;
+    auto messages = encode(encoder, { 0.0, 1.0 }, MidiOutputEncoder::Mode::ControlChange14Bit, 1, 40, 1);
+
+    // 8192 = 64 << 7, controllers above 31 are limited so the LSB stays in 32-63
+    EXPECT_EQ(messages, (std::vector<Message>{
+        { { 0xb0, 31, 64 }, 0 },
+        { { 0xb0, 63, 0 }, 0 },
+        { { 0xb0, 31, 127 }, 1 },
+        { { 0xb0, 63, 127 }, 1 },
+    }));
+}
+
+TEST(MidiOutputEncoderTest, PitchBend) {
+    MidiOutputEncoder encoder;
+    auto messages = encode(encoder, { -1.0, 0.0, 1.0 }, MidiOutputEncoder::Mode::PitchBend, 16, 0, 1);
+
+    EXPECT_EQ(messages, (std::vector<Message>{
+        { { 0xef, 0, 0 }, 0 },
+        { { 0xef, 0, 64 }, 1 },
+        { { 0xef, 127, 127 }, 2 },
+    }));
+}
+
+TEST(MidiOutputEncoderTest, Threshold) {
+    MidiOutputEncoder encoder;
+    const double step = 2.0 / 127.0; // one 7-bit step
+
+    // Moves of less than 3 steps from the last sent value are skipped
+    auto messages = encode(encoder, { -1.0, -1.0 + step, -1.0 + 2 * step, -1.0 + 3 * step, -1.0 + 4 * step },
+                           MidiOutputEncoder::Mode::ControlChange, 1, 1, 3);
+    EXPECT_EQ(messages, (std::vector<Message>{
+        { { 0xb0, 1, 0 }, 0 },
+        { { 0xb0, 1, 3 }, 3 },
+    }));
+
+    // The threshold also applies across blocks
+    EXPECT_TRUE(encode(encoder, { -1.0 + 4 * step }, MidiOutputEncoder::Mode::ControlChange, 1, 1, 3).empty());
+
+    // After a reset or a change of destination the current value is always sent
+    encoder.reset();
+    EXPECT_EQ(encode(encoder, { -1.0 + 4 * step }, MidiOutputEncoder::Mode::ControlChange, 1, 1, 3).size(), 1u);
+    EXPECT_EQ(encode(encoder, { -1.0 + 4 * step }, MidiOutputEncoder::Mode::ControlChange, 1, 2, 3).size(), 1u);
+}
+
+TEST(MidiOutputEncoderTest, MinimumInterval) {
+    // One second of a 1 Hz sine at 48 kHz moves by at least one 14-bit step on most samples
+    const double pi = std::acos(-1.0);
+    std::vector<double> sine(48000);
+    for (size_t i = 0; i < sine.size(); i++)
+        sine[i] = std::sin(2.0 * pi * static_cast<double>(i) / 48000.0);
+
+    MidiOutputEncoder unlimited;
+    const auto everyStep = encode(unlimited, sine, MidiOutputEncoder::Mode::PitchBend, 1, 0, 1);
+    EXPECT_GT(everyStep.size(), 20000u);
+
+    // 5 ms at 48 kHz, at most 200 messages per second
+    MidiOutputEncoder limited;
+    const auto messages = encode(limited, sine, MidiOutputEncoder::Mode::PitchBend, 1, 0, 1, 240);
+    EXPECT_LE(messages.size(), 201u);
+    EXPECT_GE(messages.size(), 190u);
+    for (size_t i = 1; i < messages.size(); i++)
+        EXPECT_GE(messages[i].sampleOffset - messages[i - 1].sampleOffset, 240);
+
+    // A value held back by the interval is sent once it passed, also in a later block
+    MidiOutputEncoder encoder;
+    EXPECT_EQ(encode(encoder, { -1.0, 1.0 }, MidiOutputEncoder::Mode::ControlChange, 1, 1, 1, 4).size(), 1u);
+    EXPECT_EQ(encode(encoder, { 1.0, 1.0, 1.0 }, MidiOutputEncoder::Mode::ControlChange, 1, 1, 1, 4),
+              (std::vector<Message>{ { { 0xb0, 1, 127 }, 2 } }));
+}
+
+TEST(MidiOutputEncoderTest, DestinationsDoNotCollide) {
+    using Mode = MidiOutputEncoder::Mode;
+
+    // Slots get consecutive controllers, output channels consecutive MIDI channels
+    auto destination = MidiOutputEncoder::getDestination(Mode::ControlChange, 3, 20, 2, 4, 1, 2);
+    ASSERT_TRUE(destination.has_value());
+    EXPECT_EQ(destination->channel, 4);
+    EXPECT_EQ(destination->controller, 22);
+
+    // Pitch bend gives every output of every slot its own channel
+    destination = MidiOutputEncoder::getDestination(Mode::PitchBend, 1, 0, 3, 4, 1, 2);
+    ASSERT_TRUE(destination.has_value());
+    EXPECT_EQ(destination->channel, 8);
+
+    // Ranges that do not fit are rejected rather than clamped onto a shared controller or channel
+    EXPECT_TRUE(MidiOutputEncoder::getDestination(Mode::ControlChange14Bit, 1, 28, 0, 4, 0, 1).has_value());
+    EXPECT_FALSE(MidiOutputEncoder::getDestination(Mode::ControlChange14Bit, 1, 30, 0, 4, 0, 1).has_value());
+    EXPECT_TRUE(MidiOutputEncoder::getDestination(Mode::ControlChange, 1, 116, 0, 4, 0, 1).has_value());
+    EXPECT_FALSE(MidiOutputEncoder::getDestination(Mode::ControlChange, 1, 117, 0, 4, 0, 1).has_value());
+    EXPECT_FALSE(MidiOutputEncoder::getDestination(Mode::ControlChange, 16, 0, 0, 4, 0, 2).has_value());
+    EXPECT_TRUE(MidiOutputEncoder::getDestination(Mode::PitchBend, 9, 0, 0, 4, 0, 2).has_value());
+    EXPECT_FALSE(MidiOutputEncoder::getDestination(Mode::PitchBend, 10, 0, 0, 4, 0, 2).has_value());
+    EXPECT_FALSE(MidiOutputEncoder::getDestination(Mode::ControlChange, 16, 0, 0, 4, 1, 1).has_value()); // outside the range checked
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include "../src/cpp/OutputChain.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+TEST(OutputChainTest, Sanitise) {
+    std::vector<double> values = {
+        std::numeric_limits<double>::quiet_NaN(),
+        std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(),
+        std::numeric_limits<double>::denorm_min(),
+        0.5,
+        -3.0
+    };
+    OutputChain::sanitise(values.data(), static_cast<int>(values.size()));
+
+    EXPECT_EQ(values, (std::vector<double>{ 0.0, 0.0, 0.0, 0.0, 0.5, -1.0 }));
+}
+
+TEST(OutputChainTest, DefaultSettingsOnlySanitise) {
+    OutputChain chain;
+    chain.prepare(48000.0);
+
+    std::vector<double> values = { -1.0, -0.25, 0.0, 0.75, 1.0 };
+    const auto expected = values;
+    chain.process(values.data(), static_cast<int>(values.size()), {});
+    EXPECT_EQ(values, expected);
+}
+
+TEST(OutputChainTest, SlewLimit) {
+    OutputChain chain;
+    chain.prepare(100.0);
+
+    OutputChainSettings settings;
+    settings.slewRate = 10.0; // 0.1 per sample
+
+    std::vector<double> values(20, 1.0);
+    values[0] = 0.0;
+    chain.process(values.data(), 10, settings);
+    EXPECT_DOUBLE_EQ(values[0], 0.0);
+    EXPECT_NEAR(values[5], 0.5, 1e-12);
+    EXPECT_NEAR(values[9], 0.9, 1e-12);
+
+    // State carries over to the next block
+    chain.process(values.data() + 10, 10, settings);
+    EXPECT_NEAR(values[10], 1.0, 1e-12);
+    EXPECT_EQ(values[19], 1.0);
+}
+
+TEST(OutputChainTest, Smoothing) {
+    OutputChainSettings settings;
+    settings.smoothingTime = 0.1; // 10 samples at 100 Hz
+
+    OutputChain onePole;
+    onePole.prepare(100.0);
+    settings.smoothing = OutputChainSettings::Smoothing::OnePole;
+    std::vector<double> values(100, 1.0);
+    values[0] = 0.0;
+    onePole.process(values.data(), static_cast<int>(values.size()), settings);
+    EXPECT_NEAR(values[10], 1.0 - std::exp(-1.0), 1e-9); // one time constant
+    EXPECT_NEAR(values[99], 1.0, 1e-3);
+
+    OutputChain ramp;
+    ramp.prepare(100.0);
+    settings.smoothing = OutputChainSettings::Smoothing::LinearRamp;
+    values.assign(30, 1.0);
+    values[0] = 0.0;
+    ramp.process(values.data(), static_cast<int>(values.size()), settings);
+    EXPECT_EQ(values[9], 0.0); // the first ramp holds the first value
+    EXPECT_NEAR(values[14], 0.5, 1e-12);
+    EXPECT_EQ(values[19], 1.0);
+    EXPECT_EQ(values[29], 1.0);
+
+    // An input changing on every sample does not restart the ramp, its slope stays constant
+    OutputChain moving;
+    moving.prepare(100.0);
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = i % 2 == 0 ? 0.0 : 0.5;
+    values[10] = 1.0;
+    moving.process(values.data(), static_cast<int>(values.size()), settings);
+    EXPECT_NEAR(values[11] - values[10], 0.1, 1e-12);
+    EXPECT_NEAR(values[18] - values[17], 0.1, 1e-12);
+    EXPECT_EQ(values[19], 1.0);
+}
+
+TEST(OutputChainTest, RangeAndCurve) {
+    std::vector<double> values = { -1.0, 0.0, 1.0 };
+    OutputChain::mapRange(values.data(), 3, 0.0, 0.5, 0.0);
+    EXPECT_EQ(values, (std::vector<double>{ 0.0, 0.25, 0.5 }));
+
+    // Curves keep the end points and bend the middle
+    values = { -1.0, 0.0, 1.0 };
+    OutputChain::mapRange(values.data(), 3, -1.0, 1.0, 0.5);
+    EXPECT_DOUBLE_EQ(values[0], -1.0);
+    EXPECT_GT(values[1], 0.0);
+    EXPECT_DOUBLE_EQ(values[2], 1.0);
+
+    values = { 0.0 };
+    OutputChain::mapRange(values.data(), 1, -1.0, 1.0, -0.5);
+    EXPECT_LT(values[0], 0.0);
+}
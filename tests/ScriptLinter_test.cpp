@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "../src/cpp/ScriptLinter.h"
+
+#include <algorithm>
+
+static bool hasWarning(const std::vector<LintWarning>& warnings, int line, LintWarning::Severity severity) {
+    return std::any_of(warnings.begin(), warnings.end(), [&](const LintWarning& w) {
+        return w.line == line && w.severity == severity;
+    });
+}
+
+TEST(ScriptLinterTest, CleanExpression) {
+    EXPECT_TRUE(ScriptLinter::lint("return math.sin(t * 2 * math.pi)", {"t"}).empty());
+    EXPECT_TRUE(ScriptLinter::lint("local x = t * 0.5\nreturn x * x", {"t"}).empty());
+}
+
+TEST(ScriptLinterTest, FlagsHazardsWithLines) {
+    auto warnings = ScriptLinter::lint(
+        "print(t)\n"
+        "local f = function(x) return x end\n"
+        "local v = { 1, 2 }\n"
+        "local s = 'a' .. 'b'\n"
+        "for k in pairs(v) do end\n"
+        "return f(t)",
+        {"t"});
+
+    EXPECT_TRUE(hasWarning(warnings, 1, LintWarning::Severity::High));   // print
+    EXPECT_TRUE(hasWarning(warnings, 2, LintWarning::Severity::High));   // closure
+    EXPECT_TRUE(hasWarning(warnings, 3, LintWarning::Severity::Medium)); // table
+    EXPECT_TRUE(hasWarning(warnings, 4, LintWarning::Severity::Medium)); // concatenation
+    EXPECT_TRUE(hasWarning(warnings, 5, LintWarning::Severity::High));   // pairs is not compiled
+    EXPECT_FALSE(hasWarning(warnings, 6, LintWarning::Severity::Low));   // f is a local
+
+    // Most severe first
+    EXPECT_TRUE(std::is_sorted(warnings.begin(), warnings.end(), [](const LintWarning& a, const LintWarning& b) {
+        return a.severity > b.severity;
+    }));
+}
+
+TEST(ScriptLinterTest, IgnoresStringsAndComments) {
+    auto warnings = ScriptLinter::lint(
+        "-- print({} .. x)\n"
+        "--[[ function() end\n"
+        "]] local s = \"{ .. }\" local l = [==[ print ]==]\n"
+        "return 1",
+        {});
+
+    EXPECT_TRUE(warnings.empty());
+}
+
+TEST(ScriptLinterTest, Globals) {
+    auto warnings = ScriptLinter::lint(
+        "phase = (phase or 0) + 1\n"
+        "for i = 1, 4 do phase = phase + math.sin(i) end\n"
+        "return phase",
+        {});
+
+    // Reported once, on first use
+    ASSERT_EQ(std::count_if(warnings.begin(), warnings.end(), [](const LintWarning& w) {
+        return w.message.find("'phase'") != std::string::npos;
+    }), 1);
+    EXPECT_TRUE(hasWarning(warnings, 1, LintWarning::Severity::Low));
+    EXPECT_TRUE(hasWarning(warnings, 2, LintWarning::Severity::Low)); // math.sin in a loop
+}
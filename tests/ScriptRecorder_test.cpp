@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include "../src/cpp/ScriptRecorder.h"
+
+#include <filesystem>
+
+TEST(ScriptRecorderTest, RoundTrip) {
+    namespace fs = std::filesystem;
+    const fs::path path = fs::temp_directory_path() / "script_recorder_test.fzrec";
+
+    ScriptRecorder recorder;
+    ASSERT_EQ(recorder.start(path.string()), std::nullopt);
+
+    std::vector<double> left(300), right(300);
+    for (size_t i = 0; i < left.size(); i++) {
+        left[i] = i * 0.001;
+        right[i] = -0.5;
+    }
+    const double* outputs[] = { left.data(), right.data() };
+    AudioFeatures features[2] = { { 0.1f, 0.2f, 0.3f, 40.0f, 0.05f }, {} };
+
+    recorder.recordCompile(1, 7, 0.002, false, "return t", std::string("/scripts"));
+    recorder.recordBlock(1, 7, 48000.0, 1.5, 0.0001, features, 2, outputs, 2, 300);
+    recorder.recordProcessBlock(7, 0.0003);
+    recorder.stop();
+
+    ScriptRecordingReader reader;
+    ASSERT_EQ(reader.open(path.string()), std::nullopt);
+
+    auto compile = reader.next();
+    ASSERT_TRUE(compile && std::holds_alternative<RecordedCompile>(*compile));
+    const auto& c = std::get<RecordedCompile>(*compile);
+    EXPECT_EQ(c.slot, 1);
+    EXPECT_EQ(c.blockIndex, 7u);
+    EXPECT_FALSE(c.failed);
+    EXPECT_EQ(c.script, "return t");
+    EXPECT_EQ(c.packagePath, std::optional<std::string>("/scripts"));
+
+    auto block = reader.next();
+    ASSERT_TRUE(block && std::holds_alternative<RecordedBlock>(*block));
+    const auto& b = std::get<RecordedBlock>(*block);
+    EXPECT_EQ(b.sampleRate, 48000.0);
+    EXPECT_EQ(b.startTime, 1.5);
+    EXPECT_EQ(b.numSamples, 300);
+    EXPECT_EQ(b.numChannels, 2);
+    ASSERT_EQ(b.features.size(), 2u);
+    EXPECT_EQ(b.features[0].zeroCrossingRate, 40.0f);
+    ASSERT_EQ(b.outputs.size(), 600u);
+    EXPECT_EQ(b.outputs[299], static_cast<float>(0.299));
+    EXPECT_EQ(b.outputs[300], -0.5f);
+
+    auto processBlock = reader.next();
+    ASSERT_TRUE(processBlock && std::holds_alternative<RecordedProcessBlock>(*processBlock));
+    EXPECT_EQ(std::get<RecordedProcessBlock>(*processBlock).processTime, 0.0003);
+
+    EXPECT_FALSE(reader.next().has_value());
+    fs::remove(path);
+}
+
+TEST(ScriptRecorderTest, DropsWhenFullOrStopped) {
+    namespace fs = std::filesystem;
+    const fs::path path = fs::temp_directory_path() / "script_recorder_drop_test.fzrec";
+
+    ScriptRecorder recorder(64);
+    recorder.recordProcessBlock(0, 0.0); // not recording, ignored
+    EXPECT_EQ(recorder.getDroppedRecords(), 0u);
+
+    ASSERT_EQ(recorder.start(path.string()), std::nullopt);
+    recorder.recordCompile(0, 0, 0.0, false, std::string(100, 'x'), std::nullopt);
+    EXPECT_EQ(recorder.getDroppedRecords(), 1u);
+    recorder.stop();
+
+    fs::remove(path);
+}
+
+TEST(ScriptRecorderTest, RestartsWithEmptyRing) {
+    namespace fs = std::filesystem;
+    const fs::path first = fs::temp_directory_path() / "script_recorder_first_test.fzrec";
+    const fs::path second = fs::temp_directory_path() / "script_recorder_second_test.fzrec";
+
+    ScriptRecorder recorder(256);
+    ASSERT_EQ(recorder.start(first.string()), std::nullopt);
+    recorder.recordProcessBlock(1, 0.001);
+    recorder.stop();
+    recorder.recordProcessBlock(2, 0.002); // stopped, ignored
+
+    ASSERT_EQ(recorder.start(second.string()), std::nullopt);
+    recorder.recordProcessBlock(3, 0.003);
+    recorder.stop();
+
+    ScriptRecordingReader reader;
+    ASSERT_EQ(reader.open(second.string()), std::nullopt);
+    auto processBlock = reader.next();
+    ASSERT_TRUE(processBlock && std::holds_alternative<RecordedProcessBlock>(*processBlock));
+    EXPECT_EQ(std::get<RecordedProcessBlock>(*processBlock).blockIndex, 3u);
+    EXPECT_FALSE(reader.next().has_value());
+
+    fs::remove(first);
+    fs::remove(second);
+}